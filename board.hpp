@@ -0,0 +1,73 @@
+#pragma once
+
+// Everything that differs between Picade Max style boards lives here:
+// scan geometry, where each button sits in the scan, and the LED count.
+// Buffer sizes, the PIO scan program, DMA and the input mapping are all
+// derived from `board` at compile time.
+
+// Buttons per gamepad report. The HID descriptors are built in C, so this one is
+// a macro and checked against the board below. The report pads the buttons out
+// to 16 bits, and a zero bit padding item isn't valid HID.
+#define BOARD_GAMEPAD_BUTTONS 15
+#if BOARD_GAMEPAD_BUTTONS < 1 || BOARD_GAMEPAD_BUTTONS >= 16
+#error "BOARD_GAMEPAD_BUTTONS must be 1-15 to fit the 16 bit button field"
+#endif
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+
+// Where a button appears in a sweep: which mux row (scan byte) and which input line (bit)
+struct board_input_t {
+    uint8_t row;
+    uint8_t line;
+};
+
+const size_t BOARD_MAX_PLAYER_BUTTONS = 12;  // The joystick takes the top four bits of input_t.p1/p2
+const size_t BOARD_MAX_UTIL_BUTTONS = 6;
+
+struct board_t {
+    uint8_t mux_pin;        // First of mux_rows consecutive mux outputs, driven by side-set
+    uint8_t mux_rows;
+    uint8_t input_pin;      // First of input_lines consecutive inputs
+    uint8_t input_lines;
+    uint8_t dummy_reads;    // Padding reads that round a sweep up to a power of two for the DMA ring
+    uint16_t num_leds;
+
+    uint8_t joystick_row;   // Both joysticks, P1 in the low nibble and P2 in the high nibble
+    uint8_t player_buttons;
+    uint8_t util_buttons;
+    board_input_t p1[BOARD_MAX_PLAYER_BUTTONS];  // In gamepad button order, A B X Y Start Select L1 R1 L2 R2 L3 R3
+    board_input_t p2[BOARD_MAX_PLAYER_BUTTONS];
+    board_input_t util[BOARD_MAX_UTIL_BUTTONS];  // In UTIL_ bit order
+
+    constexpr size_t sweep_bytes() const { return mux_rows + dummy_reads; }
+    constexpr size_t led_bytes() const { return num_leds * 4; }
+    // Each player's buttons plus their hotkey, X1 and X2
+    constexpr size_t gamepad_buttons() const { return player_buttons + 3; }
+};
+
+// Picade Max, see BUTTONS.md
+constexpr board_t board = {
+    .mux_pin = 0,
+    .mux_rows = 5,
+    .input_pin = 5,
+    .input_lines = 8,
+    .dummy_reads = 3,
+    .num_leds = 32 * 4,
+
+    .joystick_row = 4,
+    .player_buttons = 12,
+    .util_buttons = 6,
+    .p1 = {{0, 1}, {0, 2}, {0, 3}, {1, 0}, {0, 0}, {2, 1}, {1, 1}, {1, 3}, {1, 2}, {2, 0}, {2, 2}, {2, 3}},
+    .p2 = {{2, 7}, {3, 4}, {3, 5}, {3, 6}, {2, 6}, {1, 4}, {0, 4}, {0, 6}, {0, 5}, {0, 7}, {1, 5}, {1, 6}},
+    .util = {{3, 0}, {1, 7}, {3, 1}, {3, 2}, {2, 4}, {2, 5}},
+};
+
+static_assert(board.mux_rows >= 1 && board.mux_rows <= 5, "Mux rows are driven by side-set, which has at most 5 bits");
+static_assert(board.input_lines >= 1 && board.input_lines <= 8, "Each mux row is read as one byte");
+static_assert((board.sweep_bytes() & (board.sweep_bytes() - 1)) == 0, "The DMA ring needs a power of two sweep, adjust dummy_reads");
+static_assert(board.joystick_row < board.mux_rows, "Joystick row must be scanned");
+static_assert(board.player_buttons <= BOARD_MAX_PLAYER_BUTTONS && board.util_buttons <= BOARD_MAX_UTIL_BUTTONS, "Too many buttons");
+static_assert(board.gamepad_buttons() == BOARD_GAMEPAD_BUTTONS, "BOARD_GAMEPAD_BUTTONS doesn't match the board");
+#endif
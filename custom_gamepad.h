@@ -1,4 +1,5 @@
 #pragma once
+#include "board.hpp"
 
 #define PICADE_HID_GAMEPAD(...) \
   HID_USAGE_PAGE ( HID_USAGE_PAGE_DESKTOP     )                 ,\
@@ -15,17 +16,17 @@
     HID_REPORT_COUNT   ( 2                                      ) ,\
     HID_REPORT_SIZE    ( 8                                      ) ,\
     HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ) ,\
-    /* 15 bit Button Map */ \
+    /* BOARD_GAMEPAD_BUTTONS bit Button Map */ \
     HID_USAGE_PAGE     ( HID_USAGE_PAGE_BUTTON                  ) ,\
     HID_USAGE_MIN      ( 1                                      ) ,\
-    HID_USAGE_MAX      ( 15                                     ) ,\
+    HID_USAGE_MAX      ( BOARD_GAMEPAD_BUTTONS                  ) ,\
     HID_LOGICAL_MIN    ( 0                                      ) ,\
     HID_LOGICAL_MAX    ( 1                                      ) ,\
-    HID_REPORT_COUNT   ( 15                                     ) ,\
+    HID_REPORT_COUNT   ( BOARD_GAMEPAD_BUTTONS                  ) ,\
     HID_REPORT_SIZE    ( 1                                      ) ,\
     HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ) ,\
-    /* 1 bit reserved */ \
-    HID_REPORT_COUNT ( 1                                      )  ,\
+    /* Pad to 16 bits */ \
+    HID_REPORT_COUNT ( 16 - BOARD_GAMEPAD_BUTTONS             )  ,\
     HID_REPORT_SIZE  ( 1                                      )  ,\
     HID_INPUT        ( HID_CONSTANT                           )  ,\
   HID_COLLECTION_END \
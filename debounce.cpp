@@ -0,0 +1,123 @@
+#include "debounce.hpp"
+#include "hotpath.hpp"
+
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+#include <cstring>
+
+uint8_t debounce_windows[DEBOUNCE_LINES];
+debounce_stats_t debounce_stats = {0, 0, 0, 0};
+
+// Reports each line has read low since it last read high, saturating.
+// Starts saturated so lines that are low at boot don't look like releases.
+uint8_t debounce_low_for[DEBOUNCE_LINES];
+uint8_t debounce_clean[DEBOUNCE_LINES] = {0};
+bool debounce_changed = false;
+
+// Saved windows live in the last sector of flash
+struct debounce_store_t {
+    uint32_t magic;
+    uint8_t lines;
+    uint8_t min;
+    uint8_t max;
+    uint8_t _pad;
+    uint8_t windows[DEBOUNCE_LINES];
+};
+
+const uint32_t DEBOUNCE_STORE_MAGIC = 0x434e4244; // "DBNC"
+const uint32_t DEBOUNCE_STORE_OFFSET = PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE;
+static_assert(sizeof(debounce_store_t) <= FLASH_PAGE_SIZE, "Debounce store must fit a flash page");
+
+static inline uint8_t clamp_window(uint8_t window) {
+    return window < PICADE_DEBOUNCE_MIN ? PICADE_DEBOUNCE_MIN
+         : window > PICADE_DEBOUNCE_MAX ? PICADE_DEBOUNCE_MAX
+         : window;
+}
+
+void debounce_init() {
+    memset(debounce_low_for, 0xff, sizeof(debounce_low_for));
+
+    const debounce_store_t *store = (const debounce_store_t *)(XIP_BASE + DEBOUNCE_STORE_OFFSET);
+    bool valid = store->magic == DEBOUNCE_STORE_MAGIC && store->lines == DEBOUNCE_LINES;
+    for(auto i = 0u; i < DEBOUNCE_LINES; i++) {
+        debounce_windows[i] = clamp_window(valid ? store->windows[i] : DEBOUNCE_DEFAULT_WINDOW);
+    }
+    debounce_changed = false;
+}
+
+void PICADE_HOT(debounce_update)(const uint8_t *rows, uint8_t *out, bool hold) {
+    if(!hold) {
+        memcpy(out, rows, board.mux_rows);
+        // Forget any release in progress so it isn't mistaken for bounce later
+        memset(debounce_low_for, 0xff, sizeof(debounce_low_for));
+        return;
+    }
+
+    for(auto row = 0u; row < board.mux_rows; row++) {
+        uint8_t result = 0;
+        for(auto line = 0u; line < board.input_lines; line++) {
+            auto i = row * board.input_lines + line;
+            bool high = (rows[row] >> line) & 1;
+
+            if(high) {
+                uint8_t bounce = debounce_low_for[i];
+                if(bounce > 0 && bounce < PICADE_DEBOUNCE_MAX) {
+                    // Back high soon after a release, call it bounce and hold past it next time
+                    debounce_stats.bounces++;
+                    if(bounce >= debounce_windows[i]) debounce_stats.escaped++;
+                    uint8_t needed = clamp_window(bounce + 1 + DEBOUNCE_MARGIN);
+                    if(needed > debounce_windows[i]) {
+                        debounce_windows[i] = needed;
+                        debounce_stats.grown++;
+                        debounce_changed = true;
+                    }
+                    debounce_clean[i] = 0;
+                }
+                debounce_low_for[i] = 0;
+            } else if(debounce_low_for[i] < 0xff) {
+                debounce_low_for[i]++;
+                // Stayed low for as long as we watch for bounce, a clean release
+                if(debounce_low_for[i] == PICADE_DEBOUNCE_MAX && ++debounce_clean[i] >= DEBOUNCE_SHRINK_AFTER) {
+                    debounce_clean[i] = 0;
+                    if(debounce_windows[i] > PICADE_DEBOUNCE_MIN) {
+                        debounce_windows[i]--;
+                        debounce_stats.shrunk++;
+                        debounce_changed = true;
+                    }
+                }
+            }
+
+            // Reported high until the line has been low for its whole window
+            result |= (debounce_low_for[i] < debounce_windows[i]) << line;
+        }
+        out[row] = result;
+    }
+}
+
+bool debounce_dirty() {
+    return debounce_changed;
+}
+
+bool debounce_save() {
+    if(!debounce_changed) return false;
+
+    // Program a whole page, the rest left erased
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xff, sizeof(page));
+    debounce_store_t *store = (debounce_store_t *)page;
+    store->magic = DEBOUNCE_STORE_MAGIC;
+    store->lines = DEBOUNCE_LINES;
+    store->min = PICADE_DEBOUNCE_MIN;
+    store->max = PICADE_DEBOUNCE_MAX;
+    store->_pad = 0;
+    memcpy(store->windows, debounce_windows, sizeof(debounce_windows));
+
+    uint32_t status = save_and_disable_interrupts();
+    flash_range_erase(DEBOUNCE_STORE_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(DEBOUNCE_STORE_OFFSET, page, sizeof(page));
+    restore_interrupts(status);
+
+    debounce_changed = false;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "pico/stdlib.h"
+#include "board.hpp"
+
+// Adaptive release debounce (PICADE_ADAPTIVE_DEBOUNCE). Each input line gets its own
+// release window, in reports (~ms), learned from the bounce it actually shows:
+// a line that goes high again shortly after a release has its window grown past
+// that bounce, and a line that keeps releasing cleanly has it shrunk by one.
+// Presses are always reported instantly, as with the fixed FIFO debounce.
+#ifndef PICADE_DEBOUNCE_MIN
+#define PICADE_DEBOUNCE_MIN 1
+#endif
+
+#ifndef PICADE_DEBOUNCE_MAX
+#define PICADE_DEBOUNCE_MAX 10
+#endif
+
+const size_t DEBOUNCE_LINES = board.mux_rows * board.input_lines;
+const uint8_t DEBOUNCE_DEFAULT_WINDOW = 5;  // Where every line starts, the old fixed depth
+const uint8_t DEBOUNCE_MARGIN = 1;          // Extra reports held beyond the longest bounce seen
+const uint8_t DEBOUNCE_SHRINK_AFTER = 32;   // Clean releases in a row before a window shrinks
+
+static_assert(PICADE_DEBOUNCE_MIN >= 1 && PICADE_DEBOUNCE_MIN <= PICADE_DEBOUNCE_MAX && PICADE_DEBOUNCE_MAX < 255,
+              "Debounce bounds must be 1 <= min <= max < 255");
+
+struct debounce_stats_t {
+    uint32_t bounces;   // Releases that went high again within PICADE_DEBOUNCE_MAX reports
+    uint32_t escaped;   // ...of which got past the window and were reported as a release and press
+    uint32_t grown;     // Window increases
+    uint32_t shrunk;    // Window decreases
+};
+
+extern uint8_t debounce_windows[DEBOUNCE_LINES];  // Indexed row * input_lines + line
+extern debounce_stats_t debounce_stats;
+
+// Load learned windows from flash, falling back to DEBOUNCE_DEFAULT_WINDOW
+void debounce_init();
+
+// Debounce one sweep of mux rows into `out`. With `hold` false the raw state
+// is passed straight through and nothing is learned, for low power mode.
+void debounce_update(const uint8_t *rows, uint8_t *out, bool hold);
+
+// Write the windows to the last flash sector if they've changed since the last save.
+// This stalls everything, interrupts included, for tens of milliseconds.
+bool debounce_save();
+bool debounce_dirty();
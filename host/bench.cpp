@@ -0,0 +1,118 @@
+// Compares a naive blocking LED writer (what tools/rainbow-leds.py does) against
+// picade::Client, both talking to a PtyStandin in place of real hardware.
+// CPU is the whole process, I/O thread included, less the stand-in's own reader,
+// and is divided by the frames the stand-in actually received. Frames the client
+// coalesced away cost next to nothing but never reach the board, so they don't count.
+//
+// Usage: picade-bench [seconds] [link bytes/sec, 0 for unthrottled]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#include "picade_client.hpp"
+#include "pty_standin.hpp"
+
+using namespace picade;
+using bench_clock = std::chrono::steady_clock;
+
+static double process_cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// CPU used by everything but the stand-in since `start`
+struct CpuMeter {
+    PtyStandin &device;
+    double process_start;
+    double device_start;
+
+    explicit CpuMeter(PtyStandin &device)
+        : device(device), process_start(process_cpu_seconds()), device_start(device.cpu_seconds()) {}
+
+    double seconds() {
+        return (process_cpu_seconds() - process_start) - (device.cpu_seconds() - device_start);
+    }
+};
+
+static void rainbow(uint8_t *pixels, uint32_t tick) {
+    for(auto x = 0u; x < Frame::NUM_LEDS; x++) {
+        uint8_t h = (x * 2 + tick) & 0xff;
+        pixels[x * 4 + 0] = h;
+        pixels[x * 4 + 1] = 255 - h;
+        pixels[x * 4 + 2] = h ^ 0x55;
+        pixels[x * 4 + 3] = 31;
+    }
+}
+
+static void report(const char *name, uint64_t frames, uint64_t delivered, double seconds, double cpu) {
+    printf("%-9s %8.1f frames/s submitted %8.1f frames/s delivered %7.2f us CPU/delivered frame\n",
+           name, frames / seconds, delivered / seconds, delivered ? cpu / delivered * 1e6 : 0.0);
+}
+
+static void bench_blocking(double seconds, size_t rate) {
+    PtyStandin device(rate);
+    int fd = open(device.path().c_str(), O_RDWR | O_NOCTTY);
+    termios tty;
+    tcgetattr(fd, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(fd, TCSANOW, &tty);
+
+    uint64_t frames = 0;
+    CpuMeter meter(device);
+    auto end = bench_clock::now() + std::chrono::duration<double>(seconds);
+    while(bench_clock::now() < end) {
+        // A fresh buffer and a blocking write per frame
+        std::vector<uint8_t> buf(Frame::HEADER.begin(), Frame::HEADER.end());
+        buf.resize(Frame::HEADER.size() + Frame::PIXEL_BYTES);
+        rainbow(buf.data() + Frame::HEADER.size(), frames);
+        for(size_t done = 0; done < buf.size();) {
+            ssize_t n = write(fd, buf.data() + done, buf.size() - done);
+            if(n > 0) done += n;
+        }
+        frames++;
+    }
+    tcdrain(fd);
+    usleep(100 * 1000);
+    report("blocking", frames, device.frames(), seconds, meter.seconds());
+    close(fd);
+}
+
+static void bench_client(double seconds, size_t rate) {
+    PtyStandin device(rate);
+    uint64_t frames = 0;
+    ClientStats stats;
+    CpuMeter meter(device);
+    {
+        Client client(device.path());
+        auto end = bench_clock::now() + std::chrono::duration<double>(seconds);
+        while(bench_clock::now() < end) {
+            Frame &frame = client.acquire();
+            rainbow(frame.pixels(), frames);
+            client.submit(frame);
+            frames++;
+        }
+        client.flush();
+        stats = client.stats();
+    }
+    usleep(100 * 1000);
+    report("client", frames, device.frames(), seconds, meter.seconds());
+    printf("          %llu written, %llu coalesced, %llu write errors\n",
+           (unsigned long long)stats.written, (unsigned long long)stats.coalesced, (unsigned long long)stats.errors);
+}
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+    size_t rate = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+
+    printf("%.1fs per run, link %zu bytes/s\n", seconds, rate);
+    bench_blocking(seconds, rate);
+    bench_client(seconds, rate);
+    return 0;
+}
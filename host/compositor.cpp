@@ -0,0 +1,106 @@
+#include "compositor.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+namespace picade {
+
+    Compositor::Compositor(LayerTable *table) : table(table) {
+    }
+
+    bool Compositor::snapshot(LayerSlot &slot, Snapshot &copy) {
+        // Seqlock read, see Layer::commit(). A writer mid-update makes us retry,
+        // and after a few goes we settle for the last good copy.
+        for(auto attempt = 0; attempt < 4; attempt++) {
+            uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if(before & 1) continue;
+            if(before == copy.sequence) return true;
+
+            uint8_t rgba[N * 4];
+            std::memcpy(rgba, slot.rgba, sizeof(rgba));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if(slot.sequence.load(std::memory_order_relaxed) == before) {
+                std::memcpy(copy.rgba, rgba, sizeof(rgba));
+                copy.sequence = before;
+                copy.z = slot.z;
+                return true;
+            }
+        }
+        counters.torn++;
+        return false;
+    }
+
+    void Compositor::blend(const Snapshot &layer) {
+        // Deinterleave RGBA into planes
+        for(auto i = 0u; i < N; i++) {
+            src[0][i] = layer.rgba[i * 4 + 0];
+            src[1][i] = layer.rgba[i * 4 + 1];
+            src[2][i] = layer.rgba[i * 4 + 2];
+            src[3][i] = layer.rgba[i * 4 + 3];
+        }
+
+        // dst = (src * a + dst * (255 - a)) / 255, with the divide done as
+        // (x + 1 + (x >> 8)) >> 8 which is exact over this range and stays in 16 bits
+        for(auto c = 0u; c < 3; c++) {
+            for(auto i = 0u; i < N; i++) {
+                uint16_t a = src[3][i];
+                uint16_t x = src[c][i] * a + dst[c][i] * (255 - a);
+                dst[c][i] = (x + 1 + (x >> 8)) >> 8;
+            }
+        }
+    }
+
+    bool Compositor::compose(Frame &frame, uint8_t brightness) {
+        counters.composed++;
+
+        std::array<const Snapshot *, MAX_LAYERS> order;
+        size_t count = 0;
+        for(auto i = 0u; i < MAX_LAYERS; i++) {
+            LayerSlot &slot = table->slots[i];
+            if(slot.owner.load(std::memory_order_acquire) == 0) {
+                snapshots[i].sequence = 0;
+                continue;
+            }
+            snapshot(slot, snapshots[i]);
+            order[count++] = &snapshots[i];
+        }
+        std::stable_sort(order.begin(), order.begin() + count,
+                         [](const Snapshot *a, const Snapshot *b) { return a->z < b->z; });
+
+        std::memset(dst, 0, sizeof(dst));
+        for(auto i = 0u; i < count; i++) {
+            blend(*order[i]);
+        }
+
+        uint8_t *p = frame.pixels();
+        for(auto i = 0u; i < N; i++) {
+            p[i * 4 + 0] = dst[2][i];
+            p[i * 4 + 1] = dst[1][i];
+            p[i * 4 + 2] = dst[0][i];
+            p[i * 4 + 3] = brightness;
+        }
+
+        if(have_last && std::memcmp(last.data(), p, last.size()) == 0) {
+            return false;
+        }
+        std::memcpy(last.data(), p, last.size());
+        have_last = true;
+        counters.changed++;
+        return true;
+    }
+
+    void Compositor::reap() {
+        for(auto &slot : table->slots) {
+            uint32_t pid = slot.owner.load(std::memory_order_relaxed);
+            if(pid && kill(pid, 0) != 0 && errno == ESRCH) {
+                if(slot.owner.compare_exchange_strong(pid, 0)) {
+                    counters.reaped++;
+                }
+            }
+        }
+    }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "layers.hpp"
+#include "picade_client.hpp"
+
+namespace picade {
+
+    struct CompositorStats {
+        uint64_t composed = 0;    // Calls to compose()
+        uint64_t changed = 0;     // ...that produced a frame different from the last one
+        uint64_t torn = 0;        // Layer reads abandoned mid-update, previous copy used instead
+        uint64_t reaped = 0;      // Layers released because their owner died without cleaning up
+    };
+
+    // Blends every claimed slot in a LayerTable, lowest z first, into one LED frame.
+    // Channels are held as 16-bit planes so the blend loops are straight-line
+    // multiply-adds that the compiler can vectorise.
+    class Compositor {
+    public:
+        explicit Compositor(LayerTable *table);
+
+        // Returns true if the result differs from the previous call and should be sent
+        bool compose(Frame &frame, uint8_t brightness);
+
+        // Free slots whose owning process has gone away
+        void reap();
+
+        const CompositorStats &stats() const { return counters; }
+
+    private:
+        static constexpr size_t N = Frame::NUM_LEDS;
+
+        struct Snapshot {
+            uint32_t sequence = 0;
+            int32_t z = 0;
+            alignas(32) uint8_t rgba[N * 4] = {};
+        };
+
+        bool snapshot(LayerSlot &slot, Snapshot &copy);
+        void blend(const Snapshot &layer);
+
+        LayerTable *table;
+        std::array<Snapshot, MAX_LAYERS> snapshots;
+
+        alignas(32) uint16_t src[4][N];
+        alignas(32) uint16_t dst[3][N];
+
+        std::array<uint8_t, Frame::PIXEL_BYTES> last;
+        bool have_last = false;
+
+        CompositorStats counters;
+    };
+
+}
@@ -0,0 +1,122 @@
+#include "layers.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace picade {
+
+    // picaded's lock on the table, held by keeping this open
+    static int owner_fd = -1;
+    static LayerTable *owned_table = nullptr;
+
+    LayerTable *map_layer_table(bool create) {
+        int fd = shm_open(LAYER_TABLE_NAME, O_RDWR | (create ? O_CREAT : 0), 0666);
+        if(fd < 0) {
+            throw std::runtime_error(create ? "picade: can't create layer table" : "picade: picaded isn't running");
+        }
+
+        // The lock goes when picaded exits, however it exits, so a table left behind
+        // by a crash is never mistaken for a live one
+        if(create && flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            close(fd);
+            throw std::runtime_error("picade: picaded is already running");
+        }
+        if(!create && flock(fd, LOCK_SH | LOCK_NB) == 0) {
+            close(fd);
+            throw std::runtime_error("picade: picaded isn't running");
+        }
+        if(create && ftruncate(fd, sizeof(LayerTable)) != 0) {
+            close(fd);
+            throw std::runtime_error("picade: can't size layer table");
+        }
+
+        void *p = mmap(nullptr, sizeof(LayerTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(p == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("picade: can't map layer table");
+        }
+
+        auto table = static_cast<LayerTable *>(p);
+        if(create) {
+            // Only a brand new table is cleared, one from an earlier picaded may have
+            // layers still being drawn. Compositor::reap() frees any whose owner is gone.
+            if(table->magic != LAYER_TABLE_MAGIC) {
+                std::memset(p, 0, sizeof(LayerTable));
+                table->magic = LAYER_TABLE_MAGIC;
+            }
+            owner_fd = fd;
+            owned_table = table;
+        } else {
+            close(fd);
+            if(table->magic != LAYER_TABLE_MAGIC) {
+                munmap(p, sizeof(LayerTable));
+                throw std::runtime_error("picade: layer table isn't initialised");
+            }
+        }
+        return table;
+    }
+
+    void unmap_layer_table(LayerTable *table) {
+        munmap(table, sizeof(LayerTable));
+        if(table == owned_table) {
+            close(owner_fd);
+            owner_fd = -1;
+            owned_table = nullptr;
+        }
+    }
+
+    Layer::Layer(int32_t z) : table(map_layer_table(false)), slot(nullptr) {
+        uint32_t pid = getpid();
+        for(auto &candidate : table->slots) {
+            uint32_t free = 0;
+            if(candidate.owner.compare_exchange_strong(free, pid)) {
+                slot = &candidate;
+                break;
+            }
+        }
+        if(!slot) {
+            unmap_layer_table(table);
+            throw std::runtime_error("picade: no free layers");
+        }
+        std::memset(rgba, 0, sizeof(rgba));
+        slot->z = z;
+        commit();
+    }
+
+    Layer::~Layer() {
+        // Clear before letting go so nothing lingers on screen
+        std::memset(rgba, 0, sizeof(rgba));
+        commit();
+        slot->owner = 0;
+        unmap_layer_table(table);
+    }
+
+    void Layer::set_pixel(size_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+        uint8_t *p = rgba + index * 4;
+        p[0] = r;
+        p[1] = g;
+        p[2] = b;
+        p[3] = a;
+    }
+
+    void Layer::fill(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+        for(auto i = 0u; i < Frame::NUM_LEDS; i++) {
+            set_pixel(i, r, g, b, a);
+        }
+    }
+
+    void Layer::commit() {
+        // Seqlock: readers retry if the sequence was odd or moved while they copied
+        uint32_t seq = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(slot->rgba, rgba, sizeof(rgba));
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->sequence.store(seq + 2, std::memory_order_release);
+    }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "picade_client.hpp"
+
+namespace picade {
+
+    // Shared-memory layer table owned by picaded. Any number of processes can each
+    // claim a slot, draw RGBA into it and picaded composites every slot in z order.
+    static constexpr const char *LAYER_TABLE_NAME = "/picade-layers";
+    static constexpr uint32_t LAYER_TABLE_MAGIC = 0x4c594150; // "PAYL"
+    static constexpr size_t MAX_LAYERS = 8;
+
+    struct LayerSlot {
+        std::atomic<uint32_t> owner;     // pid of the process drawing here, 0 when free
+        std::atomic<uint32_t> sequence;  // Odd while the owner is mid-update
+        std::atomic<int32_t> z;          // Higher is drawn on top
+        uint8_t rgba[Frame::NUM_LEDS * 4];
+    };
+
+    struct LayerTable {
+        std::atomic<uint32_t> magic;
+        LayerSlot slots[MAX_LAYERS];
+    };
+
+    // Maps the layer table. picaded passes `create`, which takes an exclusive lock on the
+    // table for as long as it stays mapped and fails if another picaded holds it. A table
+    // left by an earlier picaded is reused as is, so clients' layers survive a restart.
+    // Without `create` it fails unless a picaded is running.
+    LayerTable *map_layer_table(bool create);
+    void unmap_layer_table(LayerTable *table);
+
+    // A layer claimed by this process, released on destruction
+    class Layer {
+    public:
+        explicit Layer(int32_t z);
+        ~Layer();
+
+        Layer(const Layer &) = delete;
+        Layer &operator=(const Layer &) = delete;
+
+        void set_pixel(size_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255);
+        void fill(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255);
+
+        // Publish everything drawn since the last commit
+        void commit();
+
+    private:
+        LayerTable *table;
+        LayerSlot *slot;
+        uint8_t rgba[Frame::NUM_LEDS * 4];
+    };
+
+}
@@ -0,0 +1,48 @@
+// Fills one compositor layer with a colour, for scripts and quick testing.
+// The layer is released (and cleared from the buttons) when this exits.
+//
+// Usage: picade-layer <z> <r> <g> <b> [alpha] [seconds, 0 to wait for Ctrl+C]
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+#include "layers.hpp"
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int) {
+    running = 0;
+}
+
+int main(int argc, char *argv[]) {
+    if(argc < 5) {
+        fprintf(stderr, "Usage: %s <z> <r> <g> <b> [alpha] [seconds]\n", argv[0]);
+        return 2;
+    }
+    int z = atoi(argv[1]);
+    uint8_t r = atoi(argv[2]), g = atoi(argv[3]), b = atoi(argv[4]);
+    uint8_t a = argc > 5 ? atoi(argv[5]) : 255;
+    double seconds = argc > 6 ? atof(argv[6]) : 0;
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    try {
+        picade::Layer layer(z);
+        layer.fill(r, g, b, a);
+        layer.commit();
+
+        auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+        while(running && (!seconds || std::chrono::steady_clock::now() < end)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    } catch(const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "picade_client.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <stdexcept>
+#include <termios.h>
+#include <unistd.h>
+
+namespace picade {
+
+    std::vector<std::string> find_boards() {
+        std::vector<std::string> boards;
+        glob_t results;
+        if(glob("/dev/serial/by-id/usb-Pimoroni_Picade_Max_*", 0, nullptr, &results) == 0) {
+            for(auto i = 0u; i < results.gl_pathc; i++) {
+                boards.emplace_back(results.gl_pathv[i]);
+            }
+        }
+        globfree(&results);
+        return boards;
+    }
+
+    Frame::Frame() {
+        std::memcpy(bytes.data(), HEADER.data(), HEADER.size());
+        clear();
+    }
+
+    void Frame::set_pixel(size_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t brightness) {
+        uint8_t *p = pixels() + index * 4;
+        p[0] = b;
+        p[1] = g;
+        p[2] = r;
+        p[3] = brightness;
+    }
+
+    void Frame::clear() {
+        std::memset(pixels(), 0, PIXEL_BYTES);
+    }
+
+    Client::Client(const std::string &path) {
+        fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if(fd < 0) {
+            throw std::runtime_error("picade: can't open " + path + ": " + std::strerror(errno));
+        }
+
+        // Raw bytes, no line discipline getting in the way of binary frames
+        termios tty;
+        if(tcgetattr(fd, &tty) == 0) {
+            cfmakeraw(&tty);
+            tcsetattr(fd, TCSANOW, &tty);
+        }
+
+        io = std::thread(&Client::io_thread, this);
+    }
+
+    Client::~Client() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running = false;
+        }
+        wake.notify_all();
+        io.join();
+        close(fd);
+    }
+
+    Frame &Client::acquire() {
+        std::lock_guard<std::mutex> guard(lock);
+        return frames[drawing];
+    }
+
+    void Client::submit(Frame &frame) {
+        std::unique_lock<std::mutex> guard(lock);
+        if(&frame != &frames[drawing]) return;
+
+        // The caller moves on to whichever frame is free. If a frame was already
+        // waiting it has been overtaken, it is never written and gets drawn over next.
+        int next;
+        if(pending >= 0) {
+            counters.coalesced++;
+            next = pending;
+        } else if(writing >= 0) {
+            next = 3 - drawing - writing;
+        } else {
+            next = (drawing + 1) % 3;
+        }
+
+        pending = drawing;
+        drawing = next;
+        counters.submitted++;
+        guard.unlock();
+        wake.notify_one();
+    }
+
+    void Client::send_command(std::string_view command) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            commands.emplace_back("multiverse:");
+            commands.back().append(command);
+        }
+        wake.notify_one();
+    }
+
+    void Client::flush() {
+        std::unique_lock<std::mutex> guard(lock);
+        idle.wait(guard, [this] { return (pending < 0 && writing < 0 && commands.empty()) || !running; });
+    }
+
+    ClientStats Client::stats() {
+        std::lock_guard<std::mutex> guard(lock);
+        return counters;
+    }
+
+    bool Client::write_all(const uint8_t *data, size_t len) {
+        while(len) {
+            ssize_t written = write(fd, data, len);
+            if(written > 0) {
+                data += written;
+                len -= written;
+                continue;
+            }
+            if(written < 0 && errno != EAGAIN && errno != EINTR) {
+                int error = errno;
+                std::lock_guard<std::mutex> guard(lock);
+                counters.errors++;
+                counters.last_error = error;
+                return false;
+            }
+
+            // Wait for room, waking now and then to notice shutdown
+            pollfd pfd = {fd, POLLOUT, 0};
+            poll(&pfd, 1, 100);
+            std::lock_guard<std::mutex> guard(lock);
+            if(!running) return false;
+        }
+        return true;
+    }
+
+    void Client::io_thread() {
+        std::unique_lock<std::mutex> guard(lock);
+        while(running) {
+            wake.wait(guard, [this] { return pending >= 0 || !commands.empty() || !running; });
+            if(!running) break;
+
+            std::vector<std::string> batch;
+            batch.swap(commands);
+            writing = pending;
+            pending = -1;
+            guard.unlock();
+
+            size_t bytes = 0;
+            bool ok = true;
+            for(auto &command : batch) {
+                ok = ok && write_all((const uint8_t *)command.data(), command.size());
+                bytes += command.size();
+            }
+            bool wrote_frame = false;
+            if(ok && writing >= 0) {
+                wrote_frame = write_all(frames[writing].data(), frames[writing].size());
+                if(wrote_frame) bytes += frames[writing].size();
+            }
+
+            guard.lock();
+            if(wrote_frame) counters.written++;
+            counters.bytes += bytes;
+            writing = -1;
+            if(pending < 0 && commands.empty()) idle.notify_all();
+        }
+        idle.notify_all();
+    }
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace picade {
+
+    // Boards show up as /dev/serial/by-id/usb-Pimoroni_Picade_Max_<serial>-if03
+    std::vector<std::string> find_boards();
+
+    // One LED frame, with the multiverse:data header in front of the pixels
+    // so the whole thing goes to the tty in a single write with no copying.
+    class Frame {
+    public:
+        static constexpr size_t NUM_LEDS = 32 * 4;
+        static constexpr size_t PIXEL_BYTES = NUM_LEDS * 4;
+        static constexpr std::string_view HEADER = "multiverse:data";
+
+        Frame();
+
+        void set_pixel(size_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t brightness = 31);
+        void clear();
+
+        // B G R brightness per LED, same layout as led_front_buffer on the device
+        uint8_t *pixels() { return bytes.data() + HEADER.size(); }
+        const uint8_t *data() const { return bytes.data(); }
+        size_t size() const { return bytes.size(); }
+
+    private:
+        std::array<uint8_t, HEADER.size() + PIXEL_BYTES> bytes;
+    };
+
+    struct ClientStats {
+        uint64_t submitted = 0;   // Frames handed to submit()
+        uint64_t written = 0;     // Frames that made it to the tty
+        uint64_t coalesced = 0;   // Frames replaced by a newer one before they were written
+        uint64_t bytes = 0;       // Everything written, commands included
+        uint64_t errors = 0;      // Writes that failed and were dropped, EIO once the board is unplugged
+        int last_error = 0;       // errno of the most recent failed write
+    };
+
+    // Owns the CDC tty and a dedicated I/O thread.
+    // Frames are triple buffered: one for the caller to fill, one waiting and one being
+    // written. submit() never blocks, and a waiting frame is replaced by a newer one.
+    class Client {
+    public:
+        explicit Client(const std::string &path);
+        ~Client();
+
+        Client(const Client &) = delete;
+        Client &operator=(const Client &) = delete;
+
+        // The frame to draw into next, valid until it is passed to submit()
+        Frame &acquire();
+        void submit(Frame &frame);
+
+        // Queue a raw multiverse command such as "_rst", sent ahead of any waiting frame
+        void send_command(std::string_view command);
+
+        // Block until everything submitted so far has been written
+        void flush();
+
+        ClientStats stats();
+
+    private:
+        void io_thread();
+        bool write_all(const uint8_t *data, size_t len);
+
+        int fd = -1;
+        std::thread io;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        bool running = true;
+
+        std::array<Frame, 3> frames;
+        int drawing = 0;
+        int pending = -1;
+        int writing = -1;
+        std::vector<std::string> commands;
+
+        ClientStats counters;
+    };
+
+}
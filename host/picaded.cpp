@@ -0,0 +1,167 @@
+// LED compositor daemon. Owns the Picade Max tty and lets any number of other
+// processes draw into shared-memory layers (see layers.hpp), blending them at a
+// fixed rate and only sending a frame to the board when the result changes.
+//
+// Usage: picaded [--device PATH | --standin] [--rate HZ] [--brightness 0-31]
+//                [--seconds N] [--demo]
+//
+// --standin swaps the board for a PtyStandin and --demo runs two example layers
+// in-process, which together exercise the whole path without hardware.
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "compositor.hpp"
+#include "layers.hpp"
+#include "picade_client.hpp"
+#include "pty_standin.hpp"
+
+using namespace picade;
+using daemon_clock = std::chrono::steady_clock;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int) {
+    running = 0;
+}
+
+// A slow full-strip background with a half transparent marker sweeping over it
+// that only moves a few times a second, so most ticks produce no change.
+static void demo(double seconds) {
+    Layer background(0);
+    Layer marker(10);
+    auto start = daemon_clock::now();
+    uint32_t tick = 0;
+    while(running) {
+        double t = std::chrono::duration<double>(daemon_clock::now() - start).count();
+        if(seconds && t >= seconds) break;
+
+        background.fill(0, 0, 64 + (tick / 10) % 64);
+        background.commit();
+
+        marker.fill(0, 0, 0, 0);
+        marker.set_pixel((tick / 5) % Frame::NUM_LEDS, 255, 128, 0, 128);
+        marker.commit();
+
+        tick++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string device;
+    bool standin = false;
+    bool run_demo = false;
+    double rate = 100.0;
+    double seconds = 0;
+    uint8_t brightness = 31;
+
+    for(auto i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool more = i + 1 < argc;
+        if(arg == "--device" && more) device = argv[++i];
+        else if(arg == "--standin") standin = true;
+        else if(arg == "--demo") run_demo = true;
+        else if(arg == "--rate" && more) rate = atof(argv[++i]);
+        else if(arg == "--seconds" && more) seconds = atof(argv[++i]);
+        else if(arg == "--brightness" && more) brightness = atoi(argv[++i]) & 0x1f;
+        else {
+            fprintf(stderr, "Usage: %s [--device PATH | --standin] [--rate HZ] [--brightness 0-31] [--seconds N] [--demo]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::unique_ptr<PtyStandin> pty;
+    if(standin) {
+        // Roughly what the board manages over full speed USB
+        pty = std::make_unique<PtyStandin>(1000000);
+        device = pty->path();
+    } else if(device.empty()) {
+        auto boards = find_boards();
+        if(boards.empty()) {
+            fprintf(stderr, "picaded: no Picade Max found\n");
+            return 1;
+        }
+        device = boards[0];
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    LayerTable *table;
+    try {
+        table = map_layer_table(true);
+    } catch(const std::runtime_error &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    Compositor compositor(table);
+    ClientStats sent;
+    bool failed = false;
+    {
+        Client client(device);
+        std::thread demo_thread;
+        if(run_demo) demo_thread = std::thread(demo, seconds);
+
+        auto period = std::chrono::duration_cast<daemon_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+        auto start = daemon_clock::now();
+        auto next = start;
+        auto next_reap = start;
+        while(running) {
+            auto now = daemon_clock::now();
+            if(seconds && now - start >= std::chrono::duration<double>(seconds)) break;
+
+            if(now >= next_reap) {
+                compositor.reap();
+                next_reap = now + std::chrono::seconds(1);
+
+                // Writes only start failing for good when the board goes away
+                ClientStats io = client.stats();
+                if(io.errors) {
+                    fprintf(stderr, "picaded: writing to %s failed: %s\n", device.c_str(), std::strerror(io.last_error));
+                    failed = true;
+                    break;
+                }
+            }
+
+            Frame &frame = client.acquire();
+            if(compositor.compose(frame, brightness)) {
+                client.submit(frame);
+            }
+
+            // Fixed rate, skipping ticks rather than bunching up if we fall behind
+            next += period;
+            if(next < now) next = now + period;
+            std::this_thread::sleep_until(next);
+        }
+
+        running = 0;
+        if(demo_thread.joinable()) demo_thread.join();
+
+        // One last pass so released layers are cleared from the board
+        Frame &frame = client.acquire();
+        if(compositor.compose(frame, brightness)) client.submit(frame);
+        client.flush();
+        sent = client.stats();
+    }
+    unmap_layer_table(table);
+
+    const CompositorStats &stats = compositor.stats();
+    printf("%llu ticks, %llu changed, %llu written, %llu coalesced, %llu write errors, %llu torn reads, %llu layers reaped\n",
+           (unsigned long long)stats.composed, (unsigned long long)stats.changed,
+           (unsigned long long)sent.written, (unsigned long long)sent.coalesced, (unsigned long long)sent.errors,
+           (unsigned long long)stats.torn, (unsigned long long)stats.reaped);
+
+    if(pty) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        printf("Stand-in received %llu frames\n", (unsigned long long)pty->frames());
+    }
+    return failed ? 1 : 0;
+}
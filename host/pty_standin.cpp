@@ -0,0 +1,104 @@
+#include "pty_standin.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <stdexcept>
+#include <termios.h>
+#include <unistd.h>
+
+namespace picade {
+
+    static constexpr std::string_view PREFIX = "multiverse:";
+    static constexpr size_t COMMAND_LEN = 4;
+    static constexpr size_t FRAME_SIZE = 32 * 4 * 4;
+
+    PtyStandin::PtyStandin(size_t bytes_per_second) : rate(bytes_per_second), frame(FRAME_SIZE) {
+        char name[128];
+        termios tty;
+        std::memset(&tty, 0, sizeof(tty));
+        cfmakeraw(&tty);
+        if(openpty(&master, &slave, name, &tty, nullptr) != 0) {
+            throw std::runtime_error("picade: openpty failed");
+        }
+        slave_path = name;
+        reader = std::thread(&PtyStandin::run, this);
+    }
+
+    PtyStandin::~PtyStandin() {
+        running = false;
+        reader.join();
+        close(slave);
+        close(master);
+    }
+
+    std::vector<uint8_t> PtyStandin::last_frame() {
+        while(frame_lock.test_and_set(std::memory_order_acquire)) {}
+        std::vector<uint8_t> copy = frame;
+        frame_lock.clear(std::memory_order_release);
+        return copy;
+    }
+
+    double PtyStandin::cpu_seconds() {
+        clockid_t clock;
+        timespec ts;
+        if(pthread_getcpuclockid(reader.native_handle(), &clock) != 0 || clock_gettime(clock, &ts) != 0) return 0;
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+
+    void PtyStandin::run() {
+        uint8_t buf[4096];
+        auto start = std::chrono::steady_clock::now();
+        uint64_t total = 0;
+
+        while(running) {
+            pollfd pfd = {master, POLLIN, 0};
+            if(poll(&pfd, 1, 50) <= 0) continue;
+
+            ssize_t len = read(master, buf, sizeof(buf));
+            if(len <= 0) continue;
+            parse(buf, len);
+            byte_count += len;
+            total += len;
+
+            // Hold back to the link rate, the tty buffer then applies back pressure like USB would
+            if(rate) {
+                auto due = start + std::chrono::microseconds(total * 1000000 / rate);
+                std::this_thread::sleep_until(due);
+            }
+        }
+    }
+
+    void PtyStandin::parse(const uint8_t *data, size_t len) {
+        pending.append((const char *)data, len);
+
+        while(true) {
+            size_t at = pending.find(PREFIX);
+            if(at == std::string::npos) {
+                // Keep a tail in case the prefix is split across reads
+                if(pending.size() > PREFIX.size()) pending.erase(0, pending.size() - PREFIX.size());
+                return;
+            }
+            pending.erase(0, at);
+            if(pending.size() < PREFIX.size() + COMMAND_LEN) return;
+
+            std::string_view command(pending.data() + PREFIX.size(), COMMAND_LEN);
+            size_t header = PREFIX.size() + COMMAND_LEN;
+            if(command == "data") {
+                if(pending.size() < header + FRAME_SIZE) return;
+                while(frame_lock.test_and_set(std::memory_order_acquire)) {}
+                std::memcpy(frame.data(), pending.data() + header, FRAME_SIZE);
+                frame_lock.clear(std::memory_order_release);
+                frame_count++;
+                pending.erase(0, header + FRAME_SIZE);
+            } else {
+                command_count++;
+                pending.erase(0, header);
+            }
+        }
+    }
+
+}
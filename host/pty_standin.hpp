@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace picade {
+
+    // Stands in for a Picade Max on a pseudo terminal. Parses the multiverse
+    // framing the way main.cpp does and keeps the last LED frame it was sent,
+    // so host code can be exercised and benchmarked without hardware.
+    class PtyStandin {
+    public:
+        // bytes_per_second throttles reads to roughly a real link's rate, 0 for flat out
+        explicit PtyStandin(size_t bytes_per_second = 0);
+        ~PtyStandin();
+
+        // Open this as if it were /dev/ttyACM0
+        const std::string &path() const { return slave_path; }
+
+        uint64_t frames() const { return frame_count; }
+        uint64_t commands() const { return command_count; }
+        uint64_t bytes() const { return byte_count; }
+
+        // CPU time the stand-in's reader thread has used, so benchmarks can leave it out
+        double cpu_seconds();
+
+        // Copy of the most recent LED frame, B G R brightness per LED
+        std::vector<uint8_t> last_frame();
+
+    private:
+        void run();
+        void parse(const uint8_t *data, size_t len);
+
+        int master = -1;
+        int slave = -1;
+        std::string slave_path;
+        size_t rate;
+        std::thread reader;
+        std::atomic<bool> running{true};
+
+        std::atomic<uint64_t> frame_count{0};
+        std::atomic<uint64_t> command_count{0};
+        std::atomic<uint64_t> byte_count{0};
+
+        std::string pending;
+        std::vector<uint8_t> frame;
+        std::atomic_flag frame_lock = ATOMIC_FLAG_INIT;
+    };
+
+}
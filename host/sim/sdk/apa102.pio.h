@@ -0,0 +1,6 @@
+#pragma once
+// Stands in for the header pico_generate_pio_header() makes from apa102.pio
+#include "hardware/pio.h"
+#define apa102_parallel_offset_data 4u
+extern const pio_program_t apa102_parallel_program;
+pio_sm_config apa102_parallel_program_get_default_config(uint offset);
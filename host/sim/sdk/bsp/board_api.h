@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+void board_init(void);
+uint32_t board_millis(void);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+#include "pico/stdlib.h"
+enum clock_index { clk_sys = 5 };
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint32_t clock_get_hz(enum clock_index clk_index);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#include "pico/stdlib.h"
+#define FLASH_SECTOR_SIZE 4096u
+#define FLASH_PAGE_SIZE 256u
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+// Flash is an array in the simulation, so XIP_BASE is its address
+extern uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)sim_flash)
+#ifdef __cplusplus
+extern "C" {
+#endif
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+#include "pico/stdlib.h"
+typedef void (*irq_handler_t)(void);
+enum { PIO0_IRQ_0 = 7, DMA_IRQ_0 = 11, DMA_IRQ_1 = 12 };
+#ifdef __cplusplus
+extern "C" {
+#endif
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+#ifdef __cplusplus
+}
+#endif
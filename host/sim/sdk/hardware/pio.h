@@ -0,0 +1,44 @@
+#pragma once
+#include "pico/stdlib.h"
+typedef struct { volatile uint32_t txf[4]; volatile uint32_t rxf[4]; } pio_hw_t;
+typedef pio_hw_t *PIO;
+extern pio_hw_t *pio0;
+typedef struct { uint32_t clkdiv; } pio_sm_config;
+typedef struct { const uint16_t *instructions; uint8_t length; int8_t origin; } pio_program_t;
+enum pio_fifo_join { PIO_FIFO_JOIN_NONE = 0, PIO_FIFO_JOIN_TX = 1, PIO_FIFO_JOIN_RX = 2 };
+enum pio_src_dest { pio_pins = 0, pio_x = 1, pio_y = 2, pio_null = 3 };
+enum pio_interrupt_source { pis_interrupt0 = 8 };
+#ifdef __cplusplus
+extern "C" {
+#endif
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_claim(PIO pio, uint sm);
+int pio_claim_unused_sm(PIO pio, bool required);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join);
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base);
+void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count);
+void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base);
+void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs);
+void sm_config_set_clkdiv(pio_sm_config *c, float div);
+void sm_config_set_clkdiv_int_frac(pio_sm_config *c, uint16_t div_int, uint8_t div_frac);
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap);
+pio_sm_config pio_get_default_sm_config(void);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm);
+uint32_t pio_sm_get(PIO pio, uint sm);
+void pio_interrupt_clear(PIO pio, uint irq);
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+uint pio_encode_nop(void);
+uint pio_encode_in(enum pio_src_dest src, uint count);
+uint pio_encode_out(enum pio_src_dest dest, uint count);
+uint pio_encode_sideset(uint sideset_bit_count, uint value);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+#include "pico/stdlib.h"
+typedef struct { volatile uint32_t dr; } spi_hw_t;
+typedef struct spi_inst spi_inst_t;
+extern spi_inst_t *spi0;
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint spi_init(spi_inst_t *spi, uint baudrate);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+spi_hw_t *spi_get_hw(spi_inst_t *spi);
+uint spi_get_dreq(spi_inst_t *spi, bool is_tx);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,6 @@
+#pragma once
+#include <stdint.h>
+typedef struct { volatile uint32_t ctrl; } rosc_hw_t;
+extern rosc_hw_t *rosc_hw;
+#define ROSC_CTRL_ENABLE_VALUE_ENABLE 0xfab
+#define ROSC_CTRL_ENABLE_LSB 12
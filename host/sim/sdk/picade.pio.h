@@ -0,0 +1,5 @@
+#pragma once
+// Stands in for the header pico_generate_pio_header() makes from picade.pio
+#include "hardware/pio.h"
+extern const pio_program_t picade_scan_change_program;
+pio_sm_config picade_scan_change_program_get_default_config(uint offset);
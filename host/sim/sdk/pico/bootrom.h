@@ -0,0 +1,9 @@
+#pragma once
+#include "pico/stdlib.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+void reset_usb_boot(uint32_t gpio_mask, uint32_t disable_interface_mask);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+// Just enough of the Pico SDK for the firmware to build and run on the host,
+// backed by the fakes in ../sim.cpp. Only what the firmware uses is declared.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define __not_in_flash(group) __attribute__((section(".time_critical." group)))
+#define __not_in_flash_func(func) func
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+absolute_time_t get_absolute_time(void);
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms);
+uint32_t time_us_32(void);
+void sleep_ms(uint32_t ms);
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, int fn);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+void gpio_set_pulls(uint gpio, bool up, bool down);
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+void __dmb(void);
+void __compiler_memory_barrier(void);
+enum { GPIO_FUNC_SPI = 1, GPIO_FUNC_SIO = 5, GPIO_FUNC_PIO0 = 6 };
+#ifdef __cplusplus
+}
+#endif
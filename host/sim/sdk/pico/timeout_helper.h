@@ -0,0 +1,12 @@
+#pragma once
+#include "pico/stdlib.h"
+typedef struct { absolute_time_t until; } timeout_state_t;
+typedef timeout_state_t timeout_state;
+typedef bool (*check_timeout_fn)(timeout_state_t *ts, bool reset);
+#ifdef __cplusplus
+extern "C" {
+#endif
+check_timeout_fn init_single_timeout_until(timeout_state_t *ts, absolute_time_t until);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+// pimoroni::RGBLED from pimoroni-pico, remembering the colour instead of driving pins
+namespace pimoroni {
+    class RGBLED {
+    public:
+        RGBLED(unsigned pin_r, unsigned pin_g, unsigned pin_b) : r(0), g(0), b(0) {
+            (void)pin_r; (void)pin_g; (void)pin_b;
+        }
+        void set_rgb(uint8_t red, uint8_t green, uint8_t blue) { r = red; g = green; b = blue; }
+        uint8_t r, g, b;
+    };
+}
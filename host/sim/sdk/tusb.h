@@ -0,0 +1,50 @@
+#pragma once
+// The slice of the TinyUSB device API the firmware calls, answered by ../sim.cpp
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define OPT_MCU_RP2040 1900
+#define OPT_OS_PICO 5
+#define OPT_MODE_DEFAULT_SPEED 0
+#ifndef CFG_TUSB_MCU
+#define CFG_TUSB_MCU OPT_MCU_RP2040
+#endif
+#include "tusb_config.h"
+
+#define TU_ATTR_PACKED __attribute__((packed))
+typedef enum { HID_REPORT_TYPE_INVALID, HID_REPORT_TYPE_INPUT, HID_REPORT_TYPE_OUTPUT, HID_REPORT_TYPE_FEATURE } hid_report_type_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+bool tud_init(uint8_t rhport);
+void tud_task(void);
+bool tud_mounted(void);
+bool tud_suspended(void);
+bool tud_remote_wakeup(void);
+void tud_sof_cb_enable(bool en);
+bool tud_cdc_connected(void);
+uint32_t tud_cdc_available(void);
+uint32_t tud_cdc_read(void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_write(const void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_write_flush(void);
+uint32_t tud_cdc_write_available(void);
+bool tud_hid_n_ready(uint8_t instance);
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, const void *report, uint16_t len);
+bool tud_vendor_mounted(void);
+uint32_t tud_vendor_available(void);
+uint32_t tud_vendor_read(void *buffer, uint32_t bufsize);
+
+// Callbacks the application provides
+void tud_mount_cb(void);
+void tud_umount_cb(void);
+void tud_suspend_cb(bool remote_wakeup_en);
+void tud_resume_cb(void);
+void tud_sof_cb(uint32_t frame_count);
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len);
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen);
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize);
+#ifdef __cplusplus
+}
+#endif
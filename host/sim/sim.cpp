@@ -0,0 +1,238 @@
+#include "sim.hpp"
+
+#include <cstring>
+
+#include "pico/stdlib.h"
+#include "pico/bootrom.h"
+#include "pico/timeout_helper.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/flash.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/spi.h"
+#include "hardware/structs/rosc.h"
+#include "hardware/watchdog.h"
+#include "bsp/board_api.h"
+#include "picade.pio.h"
+#include "apa102.pio.h"
+#include "tusb.h"
+
+namespace sim {
+    State state;
+
+    static irq_handler_t irq_handlers[32];
+
+    void reset() {
+        state = State{};
+        state.mounted = true;
+        for(auto &ready : state.hid_ready) ready = true;
+        memset(irq_handlers, 0, sizeof(irq_handlers));
+    }
+
+    void advance_us(uint64_t us) {
+        state.now_us += us;
+    }
+
+    void dma_complete(unsigned channel) {
+        DMAChannel &ch = state.dma[channel];
+        if(!ch.busy) return;
+        ch.busy = false;
+        if(ch.irq0_enabled) {
+            ch.irq0_pending = true;
+            if(irq_handlers[DMA_IRQ_0]) irq_handlers[DMA_IRQ_0]();
+        }
+    }
+}
+
+using sim::state;
+
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+
+static pio_hw_t pio0_hw;
+pio_hw_t *pio0 = &pio0_hw;
+static dma_hw_t dma_hw_regs;
+dma_hw_t *dma_hw = &dma_hw_regs;
+static rosc_hw_t rosc_hw_regs;
+rosc_hw_t *rosc_hw = &rosc_hw_regs;
+static spi_hw_t spi0_hw;
+spi_inst_t *spi0 = (spi_inst_t *)&spi0_hw;
+
+const pio_program_t picade_scan_change_program = {nullptr, 0, -1};
+const pio_program_t apa102_parallel_program = {nullptr, 0, -1};
+pio_sm_config picade_scan_change_program_get_default_config(uint) { return {0}; }
+pio_sm_config apa102_parallel_program_get_default_config(uint) { return {0}; }
+
+extern "C" {
+
+// Time
+
+absolute_time_t get_absolute_time(void) { return state.now_us; }
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + ms * 1000ull; }
+uint32_t time_us_32(void) { return (uint32_t)state.now_us; }
+void sleep_ms(uint32_t ms) { sim::advance_us(ms * 1000ull); }
+uint32_t board_millis(void) { return (uint32_t)(state.now_us / 1000); }
+void board_init(void) {}
+
+// Nothing arrives in the simulation unless a test puts it there, so waits just time out
+static bool check_single_timeout(timeout_state_t *ts, bool) {
+    sim::advance_us(1);
+    return state.now_us >= ts->until;
+}
+
+check_timeout_fn init_single_timeout_until(timeout_state_t *ts, absolute_time_t until) {
+    ts->until = until;
+    return check_single_timeout;
+}
+
+// Core
+
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t) {}
+void __dmb(void) {}
+void __compiler_memory_barrier(void) {}
+void reset_usb_boot(uint32_t, uint32_t) {}
+void watchdog_reboot(uint32_t, uint32_t, uint32_t) {}
+uint32_t clock_get_hz(enum clock_index) { return 125 * 1000 * 1000; }
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) { sim::irq_handlers[num] = handler; }
+void irq_set_enabled(uint, bool) {}
+
+// GPIO
+
+void gpio_init(uint) {}
+void gpio_set_function(uint, int) {}
+void gpio_set_dir(uint, bool) {}
+void gpio_put(uint, bool) {}
+void gpio_set_pulls(uint, bool, bool) {}
+
+// Flash, erased to ones like the real thing
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    memset(sim_flash + flash_offs, 0xff, count);
+    state.flash_erases++;
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    for(size_t i = 0; i < count; i++) sim_flash[flash_offs + i] &= data[i];
+    state.flash_programs++;
+}
+
+// SPI
+
+uint spi_init(spi_inst_t *, uint baudrate) { return baudrate; }
+int spi_write_blocking(spi_inst_t *, const uint8_t *, size_t len) {
+    state.spi_bytes += len;
+    return (int)len;
+}
+spi_hw_t *spi_get_hw(spi_inst_t *spi) { return (spi_hw_t *)spi; }
+uint spi_get_dreq(spi_inst_t *, bool) { return 0; }
+
+// DMA
+
+int dma_claim_unused_channel(bool) {
+    for(unsigned i = 0; i < sim::DMA_CHANNELS; i++) {
+        if(!state.dma[i].claimed) {
+            state.dma[i].claimed = true;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint) { return {0}; }
+void channel_config_set_transfer_data_size(dma_channel_config *, enum dma_channel_transfer_size) {}
+void channel_config_set_read_increment(dma_channel_config *, bool) {}
+void channel_config_set_write_increment(dma_channel_config *, bool) {}
+void channel_config_set_ring(dma_channel_config *, bool, uint) {}
+void channel_config_set_dreq(dma_channel_config *, uint) {}
+void channel_config_set_chain_to(dma_channel_config *, uint) {}
+void channel_config_set_bswap(dma_channel_config *, bool) {}
+
+void dma_channel_start(uint channel) {
+    state.dma[channel].busy = true;
+    state.dma[channel].starts++;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *, volatile void *, const volatile void *, uint, bool trigger) {
+    if(trigger) dma_channel_start(channel);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *, bool trigger) {
+    if(trigger) dma_channel_start(channel);
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) { state.dma[channel].irq0_enabled = enabled; }
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) { state.dma[channel].irq1_enabled = enabled; }
+bool dma_irqn_get_channel_status(uint, uint channel) { return state.dma[channel].irq0_pending; }
+void dma_irqn_acknowledge_channel(uint, uint channel) { state.dma[channel].irq0_pending = false; }
+void dma_channel_abort(uint channel) { state.dma[channel].busy = false; }
+bool dma_channel_is_busy(uint channel) { return state.dma[channel].busy; }
+
+// PIO
+
+void pio_gpio_init(PIO, uint) {}
+void pio_sm_claim(PIO, uint) {}
+int pio_claim_unused_sm(PIO, bool) { return 1; }
+uint pio_add_program(PIO, const pio_program_t *) { return 0; }
+void sm_config_set_fifo_join(pio_sm_config *, enum pio_fifo_join) {}
+void sm_config_set_in_pins(pio_sm_config *, uint) {}
+void sm_config_set_out_pins(pio_sm_config *, uint, uint) {}
+void sm_config_set_sideset_pins(pio_sm_config *, uint) {}
+void sm_config_set_sideset(pio_sm_config *, uint, bool, bool) {}
+void sm_config_set_clkdiv(pio_sm_config *c, float div) { c->clkdiv = (uint32_t)div; }
+void sm_config_set_clkdiv_int_frac(pio_sm_config *c, uint16_t div_int, uint8_t) { c->clkdiv = div_int; }
+void sm_config_set_in_shift(pio_sm_config *, bool, bool, uint) {}
+void sm_config_set_out_shift(pio_sm_config *, bool, bool, uint) {}
+void sm_config_set_wrap(pio_sm_config *, uint, uint) {}
+pio_sm_config pio_get_default_sm_config(void) { return {1}; }
+void pio_sm_set_consecutive_pindirs(PIO, uint, uint, uint, bool) {}
+void pio_sm_init(PIO, uint sm, uint, const pio_sm_config *config) { state.pio_clkdiv[sm] = (uint16_t)config->clkdiv; }
+void pio_sm_set_enabled(PIO, uint, bool) {}
+void pio_sm_set_clkdiv_int_frac(PIO, uint sm, uint16_t div_int, uint8_t) { state.pio_clkdiv[sm] = div_int; }
+uint pio_get_dreq(PIO, uint, bool) { return 0; }
+uint pio_sm_get_rx_fifo_level(PIO, uint) { return 0; }
+uint32_t pio_sm_get(PIO, uint) { return 0; }
+void pio_interrupt_clear(PIO, uint) {}
+void pio_set_irq0_source_enabled(PIO, enum pio_interrupt_source, bool) {}
+uint pio_encode_nop(void) { return 0; }
+uint pio_encode_in(enum pio_src_dest, uint) { return 0; }
+uint pio_encode_out(enum pio_src_dest, uint) { return 0; }
+uint pio_encode_sideset(uint, uint) { return 0; }
+
+// TinyUSB
+
+bool tud_init(uint8_t) { return true; }
+void tud_task(void) {}
+bool tud_mounted(void) { return state.mounted; }
+bool tud_suspended(void) { return state.suspended; }
+bool tud_remote_wakeup(void) {
+    state.remote_wakeups++;
+    return true;
+}
+void tud_sof_cb_enable(bool) {}
+
+bool tud_cdc_connected(void) { return false; }
+uint32_t tud_cdc_available(void) { return 0; }
+uint32_t tud_cdc_read(void *, uint32_t) { return 0; }
+uint32_t tud_cdc_write(const void *, uint32_t bufsize) { return bufsize; }
+uint32_t tud_cdc_write_flush(void) { return 0; }
+uint32_t tud_cdc_write_available(void) { return 0; }
+
+bool tud_hid_n_ready(uint8_t instance) { return state.hid_ready[instance]; }
+
+bool tud_hid_n_report(uint8_t instance, uint8_t, const void *report, uint16_t len) {
+    if(!state.hid_ready[instance]) return false;
+    state.hid_reports[instance]++;
+    if(len >= 4) memcpy(&state.hid_buttons[instance], (const uint8_t *)report + 2, sizeof(uint16_t));
+    return true;
+}
+
+bool tud_vendor_mounted(void) { return false; }
+uint32_t tud_vendor_available(void) { return 0; }
+uint32_t tud_vendor_read(void *, uint32_t) { return 0; }
+
+// usb_descriptors.c isn't part of the simulation
+void usb_serial_init(void) {}
+
+}
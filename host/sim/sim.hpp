@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Host-side stand-in for the RP2040 peripherals and TinyUSB, so the firmware
+// sources can be built natively and driven from a test. Time only moves when
+// the test says so, and everything the firmware asks of the hardware is kept
+// here to be checked.
+namespace sim {
+
+    const size_t DMA_CHANNELS = 12;
+    const size_t PIO_SMS = 4;
+    const size_t HID_INSTANCES = 3;
+
+    struct DMAChannel {
+        bool claimed;
+        bool busy;           // Started and not yet completed or aborted
+        bool irq0_enabled;
+        bool irq1_enabled;
+        bool irq0_pending;   // Completed with irq0 enabled, until acknowledged
+        uint32_t starts;     // Transfers triggered
+    };
+
+    struct State {
+        uint64_t now_us;
+
+        bool mounted;
+        bool suspended;
+        uint32_t remote_wakeups;
+
+        bool hid_ready[HID_INSTANCES];
+        uint32_t hid_reports[HID_INSTANCES];
+        uint16_t hid_buttons[HID_INSTANCES];  // Buttons in the last gamepad report
+
+        DMAChannel dma[DMA_CHANNELS];
+        uint16_t pio_clkdiv[PIO_SMS];
+        size_t spi_bytes;
+
+        uint32_t flash_erases;
+        uint32_t flash_programs;
+    };
+
+    extern State state;
+
+    // Back to power-on, with the bus mounted and every HID interface ready
+    void reset();
+
+    // Move time forward
+    void advance_us(uint64_t us);
+
+    // Finish the transfer running on `channel`, raising its interrupt if enabled
+    void dma_complete(unsigned channel);
+}
@@ -0,0 +1,127 @@
+#include <cstdio>
+
+#include "sim.hpp"
+#include "tusb.h"
+#include "rgbled.hpp"
+#include "picade.hpp"
+#include "plasma.hpp"
+
+// Drives the firmware through a USB suspend and resume on the simulated
+// hardware, checking each part of the low-power mode:
+//   - the LED refresh stops with the chain blanked, and restarts on resume
+//   - the input scan drops to its slowest clock divider
+//   - release debounce shrinks to a single sample
+//   - input is polled every 10ms, and a press asks the host to wake up
+
+// From the firmware, see main.cpp and picade.cpp
+extern pimoroni::RGBLED led;
+extern uint led_channel;
+extern uint debounce_window;
+extern uint16_t scan_div;
+void hid_task(void);
+
+const uint16_t SCAN_LOW_POWER_DIV = 65535;
+const uint DEBOUNCE_DEPTH = 5;
+
+// Player 1 A, row 0 line 1 of the scan and bit 0 of the gamepad buttons (BUTTONS.md)
+uint8_t released[PICADE_SCAN_BYTES] = {0};
+uint8_t pressed[PICADE_SCAN_BYTES] = {0b00000010};
+
+int failures = 0;
+
+#define CHECK(condition) do { \
+        if(!(condition)) { \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while(0)
+
+// Samples it takes for a release to be reported once the button reads low
+uint release_samples() {
+    picade_inject_input(pressed);
+    picade_get_input();
+    picade_inject_input(released);
+    for(auto samples = 1u; samples <= 2 * DEBOUNCE_DEPTH; samples++) {
+        if(!(picade_get_input().p1 & 0b1)) return samples;
+    }
+    return 0;
+}
+
+// Runs the HID task once a millisecond, returns how many gamepad 1 reports went out
+uint32_t run_hid_ms(uint ms) {
+    uint32_t before = sim::state.hid_reports[0];
+    for(auto i = 0u; i < ms; i++) {
+        sim::advance_us(1000);
+        hid_task();
+    }
+    return sim::state.hid_reports[0] - before;
+}
+
+int main() {
+    sim::reset();
+    picade_init();
+    plasma_init();
+    tud_mount_cb();
+    picade_inject_input(released);
+
+    // Awake: refreshing LEDs, full scan rate and debounce, reports every millisecond
+    CHECK(sim::state.dma[led_channel].busy);
+    uint32_t starts = sim::state.dma[led_channel].starts;
+    sim::dma_complete(led_channel);
+    CHECK(sim::state.dma[led_channel].starts == starts + 1);
+    CHECK(sim::state.pio_clkdiv[0] == scan_div);
+    CHECK(release_samples() == DEBOUNCE_DEPTH);
+    CHECK(run_hid_ms(100) >= 99);
+
+    // Suspend
+    size_t spi_bytes = sim::state.spi_bytes;
+    sim::state.suspended = true;
+    tud_suspend_cb(true);
+
+    CHECK(!sim::state.dma[led_channel].busy);
+    CHECK(!sim::state.dma[led_channel].irq0_enabled);
+    CHECK(sim::state.spi_bytes > spi_bytes + sizeof(led_front_buffer));  // One all-off frame
+    starts = sim::state.dma[led_channel].starts;
+    sim::dma_complete(led_channel);
+    CHECK(sim::state.dma[led_channel].starts == starts);
+    CHECK(led.r == 0 && led.g == 0 && led.b == 0);
+
+    CHECK(sim::state.pio_clkdiv[0] == SCAN_LOW_POWER_DIV);
+    CHECK(debounce_window == 1);
+    CHECK(release_samples() == 1);
+
+    // Slow polling, and nothing to wake the host for until a press
+    picade_inject_input(released);
+    run_hid_ms(10);
+    uint32_t reports = run_hid_ms(100);
+    CHECK(reports >= 9 && reports <= 11);
+    CHECK(sim::state.remote_wakeups == 0);
+
+    picade_inject_input(pressed);
+    run_hid_ms(10);
+    CHECK(sim::state.remote_wakeups == 1);
+    CHECK(sim::state.hid_buttons[0] & 0b1);
+    run_hid_ms(100);
+    CHECK(sim::state.remote_wakeups == 1);
+
+    // Resume
+    sim::state.suspended = false;
+    tud_resume_cb();
+
+    CHECK(sim::state.dma[led_channel].busy);
+    CHECK(sim::state.dma[led_channel].irq0_enabled);
+    starts = sim::state.dma[led_channel].starts;
+    sim::dma_complete(led_channel);
+    CHECK(sim::state.dma[led_channel].starts == starts + 1);
+    CHECK(led.g == 255);
+
+    CHECK(sim::state.pio_clkdiv[0] == scan_div);
+    CHECK(debounce_window == DEBOUNCE_DEPTH);
+    CHECK(release_samples() == DEBOUNCE_DEPTH);
+    picade_inject_input(released);
+    run_hid_ms(10);
+    CHECK(run_hid_ms(100) >= 99);
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
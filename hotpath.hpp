@@ -0,0 +1,18 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// PICADE_HOT_PATHS_IN_RAM places this firmware's own per-millisecond input and LED
+// functions, and the tables they read, in SRAM. They still call TinyUSB, BSP and SDK
+// code (tud_task, tud_cdc_read, tud_hid_n_ready, board_millis, spi_write_blocking...)
+// that stays in XIP flash and can still miss the cache. Build with PICADE_COPY_TO_RAM
+// to run the whole path, libraries included, from SRAM.
+// PICADE_HOT_SECTION(name) does the same for tables, or functions PICADE_HOT can't name.
+// tools/check-ram-placement.py checks the symbols listed in CMakeLists.txt, and only those.
+// tools/loop-time.py compares builds, no with/without figures have been taken yet.
+#ifdef PICADE_HOT_PATHS_IN_RAM
+#define PICADE_HOT(func) __not_in_flash_func(func)
+#define PICADE_HOT_SECTION(name) __not_in_flash(#name)
+#else
+#define PICADE_HOT(func) func
+#define PICADE_HOT_SECTION(name)
+#endif
@@ -35,6 +35,11 @@
 
 #include "picade.hpp"
 #include "plasma.hpp"
+#include "hotpath.hpp"
+#include "replay.hpp"
+#include "debounce.hpp"
+#include "telemetry.hpp"
+#include "vendor_leds.hpp"
 #include "rgbled.hpp"
 
 #include "hardware/clocks.h"
@@ -43,15 +48,80 @@
 #include "hardware/structs/rosc.h"
 #include "hardware/watchdog.h"
 #include "pico/timeout_helper.h"
+#ifdef PICADE_SOF_SAMPLING
+#include "hardware/structs/usb.h"
+#endif
 
 pimoroni::RGBLED led(17, 18, 19);
 
-const size_t MAX_UART_PACKET = 64;
-
 const size_t COMMAND_LEN = 4;
 uint8_t command_buffer[COMMAND_LEN];
 std::string_view command((const char *)command_buffer, COMMAND_LEN);
 
+// Reports are timestamped at sampling and binned by age when the host collects them
+const uint32_t SAMPLE_AGE_BUCKET_US = 100;
+const size_t SAMPLE_AGE_BUCKETS = 32;  // The last bucket catches everything older
+uint32_t sample_age_hist[SAMPLE_AGE_BUCKETS] = {0};
+uint32_t hid_queued_sample_us = 0;  // Sample time of the gamepad 1 report in flight
+
+// Boot milestones in time_us_32(), each recorded the first time it's reached
+enum boot_mark_t {
+  BOOT_MAIN,
+  BOOT_BOARD_INIT,
+  BOOT_SCAN_STARTED,
+  BOOT_USB_INIT,
+  BOOT_MOUNTED,
+  BOOT_FIRST_REPORT,
+  BOOT_LEDS_STARTED,
+  BOOT_MARK_COUNT
+};
+uint32_t boot_marks[BOOT_MARK_COUNT] = {0};
+
+void boot_mark(boot_mark_t mark) {
+  if (!boot_marks[mark]) boot_marks[mark] = time_us_32();
+}
+
+// LEDs come up once the first report is out, or after this long regardless
+const uint32_t LED_START_DEFER_US = 500 * 1000;
+
+// Set on mount so the host gets the current state straight away, even if nothing changes
+bool hid_prime = false;
+
+// Gamepads that have yet to queue a report of the latest input state
+const uint8_t HID_UNSENT_GAMEPAD_1 = 0b01;
+const uint8_t HID_UNSENT_GAMEPAD_2 = 0b10;
+uint8_t hid_unsent = 0;
+
+// Main loop timing, not counting passes that handle a command
+struct loop_stats_t {
+    uint32_t passes;
+    uint32_t total_us;
+    uint32_t max_us;
+};
+loop_stats_t loop_stats = {0, 0, 0};
+
+uint32_t last_input_change_ms = 0;
+
+#ifdef PICADE_ADAPTIVE_DEBOUNCE
+// Learned windows go to flash on "dbsv", or once the controls have sat untouched for
+// DEBOUNCE_SAVE_IDLE_MS while configured, at most once per DEBOUNCE_SAVE_INTERVAL_MS
+// to spare the flash. Never on suspend: the erase alone blows the suspend current budget.
+const uint32_t DEBOUNCE_SAVE_IDLE_MS = 60 * 1000;
+const uint32_t DEBOUNCE_SAVE_INTERVAL_MS = 15 * 60 * 1000;
+uint32_t last_debounce_save_ms = 0;
+
+void debounce_save_task(void)
+{
+  uint32_t now_ms = board_millis();
+  if ( !debounce_dirty() || !tud_mounted() || tud_suspended() || replay_running() ) return;
+  if ( now_ms - last_input_change_ms < DEBOUNCE_SAVE_IDLE_MS ) return;
+  if ( now_ms - last_debounce_save_ms < DEBOUNCE_SAVE_INTERVAL_MS ) return;
+
+  debounce_save();
+  last_debounce_save_ms = now_ms;
+}
+#endif
+
 
 extern "C" {
 void usb_serial_init(void);
@@ -68,12 +138,18 @@ enum {
   ITF_KEYBOARD,
   ITF_SERIAL,
   ITF_SERIAL_DATA,
+#if CFG_TUD_VENDOR
+  ITF_VENDOR,
+#endif
 };
 
 void hid_task(void);
+#ifdef INPUT_DEBUG
+void input_debug_task(void);
+#endif
 uint cdc_task(uint8_t *buf, size_t buf_len);
 
-uint cdc_task(uint8_t *buf, size_t buf_len) {
+uint PICADE_HOT(cdc_task)(uint8_t *buf, size_t buf_len) {
 
     if (tud_cdc_connected()) {
         if (tud_cdc_available()) {
@@ -101,8 +177,8 @@ bool cdc_wait_for(std::string_view data, uint timeout_ms=50) {
     return true;
 }
 
-size_t cdc_get_bytes(const uint8_t *buffer, const size_t len, const uint timeout_ms=1000) {
-    memset((void *)buffer, len, 0);
+size_t PICADE_HOT(cdc_get_bytes)(const uint8_t *buffer, const size_t len, const uint timeout_ms=1000) {
+    memset((void *)buffer, 0, len);
 
     uint8_t *p = (uint8_t *)buffer;
 
@@ -113,7 +189,8 @@ size_t cdc_get_bytes(const uint8_t *buffer, const size_t len, const uint timeout
     size_t bytes_remaining = len;
     while (bytes_remaining && !check_timeout(&ts, false)) {
         tud_task(); // tinyusb device task
-        size_t bytes_read = cdc_task(p, std::min(bytes_remaining, MAX_UART_PACKET));
+        // Drain as much of the CDC FIFO as we still need in one go
+        size_t bytes_read = cdc_task(p, bytes_remaining);
         bytes_remaining -= bytes_read;
         p += bytes_read;
     }
@@ -129,25 +206,64 @@ int main(void)
   //sleep_ms(10);
   //set_sys_clock_khz(250000, true);
 
+  boot_mark(BOOT_MAIN);
   led.set_rgb(255, 0, 0);
   board_init();
+  boot_mark(BOOT_BOARD_INIT);
+
+  // Start scanning before USB so the debounce is primed by the time the host configures us
+  picade_init();
+  boot_mark(BOOT_SCAN_STARTED);
+
   // Fetch the Pico serial (actually the flash chip ID) into `usb_serial`
   usb_serial_init();
 
   // init device stack on configured roothub port
   tud_init(BOARD_TUD_RHPORT);
+  boot_mark(BOOT_USB_INIT);
 
   led.set_rgb(0, 0, 255);
 
-  picade_init();
-  plasma_init();
+  // plasma_init() is deferred to the main loop, it isn't needed to get input flowing
 
-  led.set_rgb(0, 255, 0);
+  bool leds_started = false;
 
   while (1)
   {
+    uint32_t loop_start_us = time_us_32();
     tud_task();
+    replay_task();
     hid_task();
+    plasma_task();
+    telemetry_task();
+#ifdef INPUT_DEBUG
+    input_debug_task();
+#endif
+
+    if (!leds_started && !tud_suspended()
+    && (boot_marks[BOOT_FIRST_REPORT] || time_us_32() - boot_marks[BOOT_MAIN] > LED_START_DEFER_US)) {
+      plasma_init();
+      leds_started = true;
+      boot_mark(BOOT_LEDS_STARTED);
+      led.set_rgb(0, 255, 0);
+    }
+
+    uint32_t loop_us = time_us_32() - loop_start_us;
+    loop_stats.passes++;
+    loop_stats.total_us += loop_us;
+    loop_stats.max_us = std::max(loop_stats.max_us, loop_us);
+
+    // Nothing to do but watch for a wakeup press, so idle between scans
+    if (tud_suspended()) {
+      sleep_ms(1);
+      continue;
+    }
+#if CFG_TUD_VENDOR
+    vendor_leds_task();
+#endif
+#ifdef PICADE_ADAPTIVE_DEBOUNCE
+    debounce_save_task();
+#endif
     //cdc_task();
 
     if (tud_cdc_connected()) {
@@ -168,6 +284,163 @@ int main(void)
             continue;
         }
 
+        // Queue a frame for a set time: uint32 device time_us_32() followed by the frame.
+        // It is latched at the first LED refresh on or after that time.
+        if(command == "pres") {
+            uint32_t present_at_us;
+            if (cdc_get_bytes((uint8_t *)&present_at_us, sizeof(present_at_us)) != sizeof(present_at_us)) {
+              continue;
+            }
+            uint8_t *frame = plasma_queue_reserve();
+            if (cdc_get_bytes(frame, sizeof(led_front_buffer)) == sizeof(led_front_buffer)) {
+              plasma_queue_commit(present_at_us);
+            }
+            continue;
+        }
+
+        // Replies below go out as telemetry records (see telemetry.hpp) tagged
+        // with the command name, the payloads are described with each command.
+
+        // Presentation stats: uint32 device time_us_32() followed by plasma_stats_t
+        if(command == "stat") {
+            uint32_t now_us = time_us_32();
+            plasma_stats_t stats = plasma_get_stats();
+            if (telemetry_begin("stat", sizeof(now_us) + sizeof(stats))) {
+              telemetry_append(&now_us, sizeof(now_us));
+              telemetry_append(&stats, sizeof(stats));
+              telemetry_commit();
+            }
+            continue;
+        }
+
+        // Input scan consistency: picade_scan_stats_t
+        if(command == "scan") {
+            picade_scan_stats_t stats = picade_get_scan_stats();
+            telemetry_send("scan", &stats, sizeof(stats));
+            continue;
+        }
+
+#ifdef PICADE_ADAPTIVE_DEBOUNCE
+        // Learned release windows: uint8 min, max, line count, unsaved flag,
+        // debounce_stats_t, then one uint8 window per line (row * input_lines + line)
+        if(command == "dbnc") {
+            const uint8_t info[4] = {PICADE_DEBOUNCE_MIN, PICADE_DEBOUNCE_MAX, DEBOUNCE_LINES, debounce_dirty()};
+            if (telemetry_begin("dbnc", sizeof(info) + sizeof(debounce_stats) + sizeof(debounce_windows))) {
+              telemetry_append(info, sizeof(info));
+              telemetry_append(&debounce_stats, sizeof(debounce_stats));
+              telemetry_append(debounce_windows, sizeof(debounce_windows));
+              telemetry_commit();
+            }
+            continue;
+        }
+
+        // Save the learned windows to flash now: uint8 1 if written, 0 if unchanged
+        if(command == "dbsv") {
+            uint8_t saved = debounce_save();
+            if (saved) last_debounce_save_ms = board_millis();
+            telemetry_send("dbsv", &saved, sizeof(saved));
+            continue;
+        }
+#endif
+
+#if CFG_TUD_VENDOR
+        // Vendor interface LED frames: vendor_leds_stats_t
+        if(command == "vndr") {
+            telemetry_send("vndr", &vendor_leds_stats, sizeof(vendor_leds_stats));
+            continue;
+        }
+#endif
+
+        // Telemetry channel stats: telemetry_stats_t
+        if(command == "tlmy") {
+            telemetry_stats_t stats = telemetry_get_stats();
+            telemetry_send("tlmy", &stats, sizeof(stats));
+            continue;
+        }
+
+        // Report sample age histogram: SAMPLE_AGE_BUCKETS uint32 counts of
+        // SAMPLE_AGE_BUCKET_US each, then start counting afresh
+        if(command == "ages") {
+            telemetry_send("ages", sample_age_hist, sizeof(sample_age_hist));
+            memset(sample_age_hist, 0, sizeof(sample_age_hist));
+            continue;
+        }
+
+        // Boot milestones: BOOT_MARK_COUNT uint32 time_us_32() values, 0 if not reached
+        if(command == "boot") {
+            telemetry_send("boot", boot_marks, sizeof(boot_marks));
+            continue;
+        }
+
+        // Main loop timing: loop_stats_t, then start counting afresh
+        if(command == "loop") {
+            telemetry_send("loop", &loop_stats, sizeof(loop_stats));
+            loop_stats = {0, 0, 0};
+            continue;
+        }
+
+        // Several frames back to back: uint8 frame count followed by the frames.
+        // Each frame is shown as soon as it lands and the count actually received is
+        // sent back once the batch is done, the host should wait for it before sending
+        // another batch so it can never run ahead of the device.
+        if(command == "bulk") {
+            uint8_t frame_count;
+            if (cdc_get_bytes(&frame_count, sizeof(frame_count)) != sizeof(frame_count)) {
+              continue;
+            }
+            uint8_t frames_received = 0;
+            while (frames_received < frame_count) {
+              if (cdc_get_bytes(led_front_buffer, sizeof(led_front_buffer)) != sizeof(led_front_buffer)) {
+                break;
+              }
+              plasma_flip();
+              frames_received++;
+              hid_task(); // Don't starve input while a long batch streams in
+            }
+            telemetry_send("bulk", &frames_received, sizeof(frames_received));
+            continue;
+        }
+
+        // Upload and start an input script:
+        // uint16 step count followed by that many replay_step_t
+        if(command == "rply") {
+            uint16_t step_count;
+            if (cdc_get_bytes((uint8_t *)&step_count, sizeof(step_count)) != sizeof(step_count)) {
+              continue;
+            }
+            // The upload overwrites replay_steps, so stop any script still running off them.
+            // If the upload is cut short the hardware scan stays in charge.
+            replay_stop();
+            size_t steps_kept = std::min((size_t)step_count, REPLAY_MAX_STEPS);
+            size_t script_len = steps_kept * sizeof(replay_step_t);
+            if (cdc_get_bytes((uint8_t *)replay_steps, script_len, 2000) != script_len) {
+              continue;
+            }
+            // Steps past REPLAY_MAX_STEPS are read and thrown away, left in the
+            // FIFO they would be parsed as the next command
+            bool complete = true;
+            for (size_t i = steps_kept; i < step_count && complete; i++) {
+              replay_step_t surplus;
+              complete = cdc_get_bytes((uint8_t *)&surplus, sizeof(surplus)) == sizeof(surplus);
+            }
+            if (complete) {
+              replay_start(steps_kept);
+            }
+            continue;
+        }
+
+        // Return the report timestamps from the last script:
+        // uint16 event count followed by that many replay_event_t
+        if(command == "rlog") {
+            uint16_t event_count = replay_running() ? 0 : replay_event_count;
+            if (telemetry_begin("rlog", sizeof(event_count) + event_count * sizeof(replay_event_t))) {
+              telemetry_append(&event_count, sizeof(event_count));
+              telemetry_append(replay_events, event_count * sizeof(replay_event_t));
+              telemetry_commit();
+            }
+            continue;
+        }
+
         if(command == "_rst") {
             sleep_ms(500);
             save_and_disable_interrupts();
@@ -197,6 +470,8 @@ int main(void)
 // Invoked when device is mounted
 void tud_mount_cb(void)
 {
+  boot_mark(BOOT_MOUNTED);
+  hid_prime = true;
 }
 
 // Invoked when device is unmounted
@@ -210,32 +485,91 @@ void tud_umount_cb(void)
 void tud_suspend_cb(bool remote_wakeup_en)
 {
   (void) remote_wakeup_en;
+  plasma_suspend();
+  picade_set_low_power(true);
+  led.set_rgb(0, 0, 0);
 }
 
 // Invoked when usb bus is resumed
 void tud_resume_cb(void)
 {
+  picade_set_low_power(false);
+  plasma_resume();
+  led.set_rgb(0, 255, 0);
 }
 
 //--------------------------------------------------------------------+
 // USB HID
 //--------------------------------------------------------------------+
 
-void hid_task(void)
+#ifdef PICADE_SOF_SAMPLING
+// tud_sof_cb() is queued and only runs from tud_task(), up to a loop pass after the
+// frame started, so frame edges come from the frame number the USB controller latches
+// on every SOF instead. The edge fell somewhere between the poll that saw the number
+// change and the poll before it. Taking the earlier one means a sample is at worst one
+// poll gap early, never late for the host.
+uint32_t sof_frame = 0;
+uint32_t sof_us = 0;       // Estimated time of the latest SOF
+uint32_t sof_poll_us = 0;  // When sof_rd was last polled
+bool sof_pending = false;  // No sample taken for the latest frame yet
+#endif
+
+// Should hid_task take a new sample on this pass?
+bool PICADE_HOT(hid_sample_due)(void)
 {
-  // Poll every 10ms
-  const uint32_t interval_ms = 1;
+  // Poll every 1ms, or every 10ms while suspended
+  const uint32_t interval_ms = tud_suspended() ? 10 : 1;
   static uint32_t start_ms = 0;
-  static bool state = false;
 
-  if ( board_millis() - start_ms < interval_ms) return; // not enough time
+#ifdef PICADE_SOF_SAMPLING
+  // While frames are flowing sample once per frame, PICADE_SOF_LEAD_US before the
+  // next SOF, so the report is as fresh as it can be when the host polls for it.
+  // sof_rd is only read while awake, reading it clears the SOF interrupt TinyUSB
+  // may be using to spot a resume.
+  if ( tud_mounted() && !tud_suspended() )
+  {
+    uint32_t now_us = time_us_32();
+    uint32_t frame = usb_hw->sof_rd & USB_SOF_RD_BITS;
+    if ( frame != sof_frame )
+    {
+      sof_frame = frame;
+      sof_us = sof_poll_us;
+      sof_pending = true;
+    }
+    sof_poll_us = now_us;
+
+    if ( !sof_pending || now_us - sof_us < 1000 - PICADE_SOF_LEAD_US ) return false;
+    sof_pending = false;
+    start_ms = board_millis();
+    return true;
+  }
+#endif
+
+  if ( board_millis() - start_ms < interval_ms) return false; // not enough time
   start_ms += interval_ms;
+  return true;
+}
 
+void PICADE_HOT(hid_task)(void)
+{
+  static bool state = false;
+  static bool record_pending = false;  // A change for the replay log that isn't fully queued yet
+
+  if ( !hid_sample_due() ) return;
+
+  // Nothing has moved, the debounce has settled and both gamepads have queued the
+  // latest state, so the host already has it
+  if ( !picade_input_pending() && !replay_running() && !hid_prime && !hid_unsent ) return;
+
+  uint32_t sample_us = time_us_32();
   input_t in = picade_get_input();
 
   if(in.changed) {
+    last_input_change_ms = board_millis();
     state = !state;
     led.set_rgb(255 * state, 0, 0);
+    hid_unsent = HID_UNSENT_GAMEPAD_1 | HID_UNSENT_GAMEPAD_2;
+    record_pending = true;
   }
 
   // Remote wakeup
@@ -270,24 +604,56 @@ void hid_task(void)
   {
     //tud_hid_n_gamepad_report(ITF_GAMEPAD_1, 0, in.p1_x, in.p1_y, 0, 0, 0, 0, 0, in.p1 & BUTTON_MASK);
     uint16_t extra = 0;
-    extra |= (in.util & UTIL_P1_HOTKEY) ? (1 << 12) : 0;
-    extra |= (in.util & UTIL_P1_X1) ? (1 << 13) : 0;
-    extra |= (in.util & UTIL_P1_X2) ? (1 << 14) : 0;
-    picade_gamepad_report(ITF_GAMEPAD_1, in.p1_x, in.p1_y, (in.p1 & BUTTON_MASK) | extra);
+    extra |= (in.util & UTIL_P1_HOTKEY) ? GAMEPAD_HOTKEY : 0;
+    extra |= (in.util & UTIL_P1_X1) ? GAMEPAD_X1 : 0;
+    extra |= (in.util & UTIL_P1_X2) ? GAMEPAD_X2 : 0;
+    if ( picade_gamepad_report(ITF_GAMEPAD_1, in.p1_x, in.p1_y, (in.p1 & BUTTON_MASK) | extra) )
+    {
+      // Only a report that was actually queued gets its age tracked, a sample
+      // taken while one is still waiting mustn't make that one look fresher
+      hid_queued_sample_us = sample_us;
+      boot_mark(BOOT_FIRST_REPORT);
+      hid_prime = false;
+      hid_unsent &= ~HID_UNSENT_GAMEPAD_1;
+    }
   }
 
   if ( tud_hid_n_ready(ITF_GAMEPAD_2) )
   {
     //tud_hid_n_gamepad_report(ITF_GAMEPAD_2, 0, in.p2_x, in.p2_y, 0, 0, 0, 0, 0, in.p2 & BUTTON_MASK);
     uint16_t extra = 0;
-    extra |= (in.util & UTIL_P2_HOTKEY) ? (1 << 12) : 0;
-    extra |= (in.util & UTIL_P2_X1) ? (1 << 13) : 0;
-    extra |= (in.util & UTIL_P2_X2) ? (1 << 14) : 0;
-    picade_gamepad_report(ITF_GAMEPAD_2, in.p2_x, in.p2_y, (in.p2 & BUTTON_MASK) | extra);
+    extra |= (in.util & UTIL_P2_HOTKEY) ? GAMEPAD_HOTKEY : 0;
+    extra |= (in.util & UTIL_P2_X1) ? GAMEPAD_X1 : 0;
+    extra |= (in.util & UTIL_P2_X2) ? GAMEPAD_X2 : 0;
+    if ( picade_gamepad_report(ITF_GAMEPAD_2, in.p2_x, in.p2_y, (in.p2 & BUTTON_MASK) | extra) )
+    {
+      hid_unsent &= ~HID_UNSENT_GAMEPAD_2;
+    }
+  }
+
+  // Log a change once both gamepads have queued it, not when it was sampled,
+  // so a report that couldn't go out yet is never timed
+  if ( record_pending && !hid_unsent )
+  {
+    replay_record(in);
+    record_pending = false;
   }
 }
 
 
+// Invoked when a report has been collected by the host
+void PICADE_HOT(tud_hid_report_complete_cb)(uint8_t instance, uint8_t const* report, uint16_t len)
+{
+  (void) report;
+  (void) len;
+
+  // Gamepad 1 goes out on every sample, so one interface is enough to time them all
+  if ( instance != ITF_GAMEPAD_1 ) return;
+
+  uint32_t age_us = time_us_32() - hid_queued_sample_us;
+  sample_age_hist[std::min(age_us / SAMPLE_AGE_BUCKET_US, (uint32_t)SAMPLE_AGE_BUCKETS - 1)]++;
+}
+
 // Invoked when received GET_REPORT control request
 // Application must fill buffer report's content and return its length.
 // Return zero will cause the stack to STALL request
@@ -319,40 +685,16 @@ void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t rep
 // USB CDC
 //--------------------------------------------------------------------+
 
-/*
-void cdc_task(void)
+#ifdef INPUT_DEBUG
+// Raw scan bytes as an "inpt" telemetry record twice a second
+void input_debug_task(void)
 {
   const uint32_t interval_ms = 500;
   static uint32_t start_ms = 0;
-  static uint32_t ptr = 0;
-  //uint8_t buf[64] = {0};
-
-  if( tud_cdc_available() ) {
-    //ptr = tud_cdc_read(led_buffer + ptr, sizeof(led_buffer));
-    //if(ptr >= sizeof(led_buffer)){
-    //  ptr = 0;
-    //}
-  }
 
-  if(tud_cdc_connected()) {
-#ifdef INPUT_DEBUG
-    if ( board_millis() - start_ms < interval_ms) return; // not enough time
-    start_ms += interval_ms;
-    tud_cdc_write_str("input: ");
-    for (auto i = 0u; i < 8; i++) {
-      uint8_t in = input_debug[i];
-      for (auto j = 0u; j < 8; j++) {
-        if (in & (0b10000000 >>  j)) {
-          tud_cdc_write_str("1");
-        } else {
-          tud_cdc_write_str("0");
-        }
-      }
-      tud_cdc_write_str(" ");
-    }
-    tud_cdc_write_str("\r\n");
-    tud_cdc_write_flush();
-#endif
-  }
+  if ( board_millis() - start_ms < interval_ms) return; // not enough time
+  start_ms += interval_ms;
+
+  telemetry_send("inpt", input_debug, sizeof(input_debug));
 }
-*/
+#endif
@@ -1,15 +1,40 @@
 #include "picade.hpp"
+#include "hotpath.hpp"
+#include "debounce.hpp"
 
 #include "hardware/pio.h"
 #include "hardware/dma.h"
 #include "hardware/irq.h"
 #include "hardware/clocks.h"
+#include "hardware/sync.h"
 #include "picade.pio.h"
 
-uint8_t picade_input_data[8] __attribute__((aligned(8))) = {0};
-uint32_t transfer_count = 5 + 3;  // 5 bytes of input + 3 dummy bytes
+// Ping-pong sweep buffers. Whole sweeps land in alternate buffers and
+// sweep_sequence counts completed sweeps, so the newest complete sweep is
+// always picade_sweep[(sweep_sequence - 1) & 1] and the other is being written.
+uint8_t picade_sweep[2][PICADE_SCAN_BYTES] __attribute__((aligned(PICADE_SCAN_BYTES))) = {0};
+volatile uint32_t sweep_sequence = 0;
 
-bool operator==(const input_t& lhs, const input_t& rhs)
+picade_scan_stats_t scan_stats = {0, 0, 0, 0};
+uint32_t last_sweep_sequence = 0;
+
+// Injected raw scan bytes for picade_get_input(), nullptr for the live scan
+const uint8_t *input_source = nullptr;
+
+const uint scan_sm = 0;
+const uint32_t scan_hz = 30000;
+const uint16_t scan_low_power_div = 65535; // Slowest the PIO can go, ~140 sweeps/sec at 125MHz
+uint16_t scan_div = 0;
+
+#ifdef PICADE_SCAN_CHANGE_IRQ
+static_assert(board.mux_rows == 5 && board.input_lines == 8 && board.joystick_row == 4,
+              "picade_scan_change is written by hand for 5 rows of 8 with the joysticks last");
+
+volatile bool scan_changed = false;  // Set by scan_change_handler(), cleared by picade_input_pending()
+uint debounce_settle = 0;
+#endif
+
+bool PICADE_HOT_SECTION(input_compare) operator==(const input_t& lhs, const input_t& rhs)
 {
     return lhs.p1 == rhs.p1
         && lhs.p2 == rhs.p2
@@ -20,7 +45,7 @@ bool operator==(const input_t& lhs, const input_t& rhs)
         && lhs.p2_y == rhs.p2_y;
 }
 
-bool operator!=(const input_t& lhs, const input_t& rhs)
+bool PICADE_HOT_SECTION(input_compare) operator!=(const input_t& lhs, const input_t& rhs)
 {
     return !(lhs == rhs);
 }
@@ -38,163 +63,289 @@ void gpio_setup_output(PIO pio, uint pin) {
     gpio_put(pin, 0);
 }
 
+#ifdef PICADE_SCAN_CHANGE_IRQ
+// picade_scan_change only speaks up when something moved
+void PICADE_HOT(scan_change_handler)() {
+    pio_interrupt_clear(pio0, 0);
+    while(pio_sm_get_rx_fifo_level(pio0, scan_sm) >= 2) {
+        uint32_t rows = pio_sm_get(pio0, scan_sm);
+        uint32_t joysticks = pio_sm_get(pio0, scan_sm);
+        uint8_t *sweep = picade_sweep[sweep_sequence & 1];
+        sweep[0] = rows >> 24;
+        sweep[1] = rows >> 16;
+        sweep[2] = rows >> 8;
+        sweep[3] = rows;
+        sweep[4] = joysticks;
+        sweep_sequence++;
+    }
+    scan_changed = true;
+}
+#else
+uint sweep_dma[2];
+
+// Each ping-pong channel raises DMA_IRQ_1 as it finishes a sweep
+void PICADE_HOT(sweep_dma_handler)() {
+    uint32_t mask = (1u << sweep_dma[0]) | (1u << sweep_dma[1]);
+    uint32_t done = dma_hw->ints1 & mask;
+    dma_hw->ints1 = done;
+    // The channels strictly alternate, so even if both finished before we got
+    // here the count (and with it which buffer is newest) stays right
+    sweep_sequence += __builtin_popcount(done);
+    // Interrupts held off for several sweeps (a flash write) lose completions,
+    // so keep the newest buffer pointing away from whichever channel is running
+    uint writing = dma_channel_is_busy(sweep_dma[1]) ? 1 : 0;
+    if(((sweep_sequence - 1) & 1) == writing) sweep_sequence++;
+}
+
+// One nop + in per mux row (the nop lets the mux settle), then the dummy reads.
+// Every read is autopushed to the RX FIFO as a byte for the DMA ring.
+const uint scan_program_length = board.mux_rows * 2 + 1 + board.dummy_reads;
+uint16_t scan_instructions[scan_program_length];
+
+pio_program_t build_scan_program() {
+    uint i = 0;
+    for(auto row = 0u; row < board.mux_rows; row++) {
+        uint side = pio_encode_sideset(board.mux_rows, 1u << row);
+        scan_instructions[i++] = pio_encode_nop() | side;
+        scan_instructions[i++] = pio_encode_in(pio_pins, board.input_lines) | side;
+    }
+    uint side = pio_encode_sideset(board.mux_rows, 0);
+    scan_instructions[i++] = pio_encode_nop() | side;
+    for(auto dummy = 0u; dummy < board.dummy_reads; dummy++) {
+        scan_instructions[i++] = pio_encode_in(pio_pins, board.input_lines) | side;
+    }
+    return {scan_instructions, (uint8_t)scan_program_length, -1};
+}
+#endif
+
 void picade_init() {
     PIO pio = pio0;
-    uint sm = 0;
+    uint sm = scan_sm;
 
-    auto dma_control = dma_claim_unused_channel(true);
-    auto dma_channel = dma_claim_unused_channel(true);
+#ifdef PICADE_ADAPTIVE_DEBOUNCE
+    debounce_init();
+#endif
 
     // Input pins
-    gpio_setup_input(5);
-    gpio_setup_input(6);
-    gpio_setup_input(7);
-    gpio_setup_input(8);
-    gpio_setup_input(9);
-    gpio_setup_input(10);
-    gpio_setup_input(11);
-    gpio_setup_input(12);
+    for(auto i = 0u; i < board.input_lines; i++) {
+        gpio_setup_input(board.input_pin + i);
+    }
 
     // Mux pins
-    gpio_setup_output(pio, 0);
-    gpio_setup_output(pio, 1);
-    gpio_setup_output(pio, 2);
-    gpio_setup_output(pio, 3);
-    gpio_setup_output(pio, 4);
+    for(auto i = 0u; i < board.mux_rows; i++) {
+        gpio_setup_output(pio, board.mux_pin + i);
+    }
 
     pio_sm_claim(pio, sm);
 
-    auto offset = pio_add_program(pio, &picade_scan_program);
+#ifdef PICADE_SCAN_CHANGE_IRQ
+    auto offset = pio_add_program(pio, &picade_scan_change_program);
+    pio_sm_config config = picade_scan_change_program_get_default_config(offset);
+    // Sweeps are compared in PIO and pushed by hand, two words per change
+    sm_config_set_in_shift(&config, false, false, 32);
+#else
+    pio_program_t scan_program = build_scan_program();
+    auto offset = pio_add_program(pio, &scan_program);
+    pio_sm_config config = pio_get_default_sm_config();
+    sm_config_set_wrap(&config, offset, offset + scan_program_length - 1);
+    // One push per mux row, so each row lands in its own byte of the sweep
+    sm_config_set_in_shift(&config, false, true, board.input_lines);
+#endif
 
-    pio_sm_config config = picade_scan_program_get_default_config(offset);
     sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_RX);
-    sm_config_set_in_pins(&config, 5);
-    sm_config_set_sideset_pins(&config, 0);
-    sm_config_set_sideset(&config, 5, false, false);
-    auto div = clock_get_hz(clk_sys) / 30000;
-    sm_config_set_clkdiv(&config, div);
-    sm_config_set_in_shift(&config, false, true, 8);
+    sm_config_set_in_pins(&config, board.input_pin);
+    sm_config_set_sideset_pins(&config, board.mux_pin);
+    sm_config_set_sideset(&config, board.mux_rows, false, false);
+    scan_div = clock_get_hz(clk_sys) / scan_hz;
+    sm_config_set_clkdiv_int_frac(&config, scan_div, 0);
 
-    pio_sm_set_consecutive_pindirs(pio, sm, 5, 8, false);
-    pio_sm_set_consecutive_pindirs(pio, sm, 0, 5, true);
+    pio_sm_set_consecutive_pindirs(pio, sm, board.input_pin, board.input_lines, false);
+    pio_sm_set_consecutive_pindirs(pio, sm, board.mux_pin, board.mux_rows, true);
 
     pio_sm_init(pio, sm, offset, &config);
 
-    dma_channel_config dma_control_config = dma_channel_get_default_config(dma_control);
-    channel_config_set_transfer_data_size(&dma_control_config, DMA_SIZE_32);
-    channel_config_set_read_increment(&dma_control_config, false);
-    channel_config_set_write_increment(&dma_control_config, false);
-    dma_channel_configure(dma_control,
-        &dma_control_config,
-        &dma_hw->ch[dma_channel].al1_transfer_count_trig,
-        &transfer_count,
-        1,
-        false
-    );
-
-    dma_channel_config dma_config = dma_channel_get_default_config(dma_channel);
-    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_8);
-    channel_config_set_bswap(&dma_config, false);
-    channel_config_set_read_increment(&dma_config, false);
-    channel_config_set_write_increment(&dma_config, true);
-    channel_config_set_ring(&dma_config, true, 3); // Wrap at 8
-
-    channel_config_set_dreq(&dma_config, pio_get_dreq(pio, sm, false));
-
-    channel_config_set_chain_to(&dma_config, dma_control);
-
-    dma_channel_configure(dma_channel,
-        &dma_config,
-        picade_input_data,
-        &pio->rxf[sm],
-        transfer_count,
-        true
-    );
+#ifdef PICADE_SCAN_CHANGE_IRQ
+    pio_set_irq0_source_enabled(pio, pis_interrupt0, true);
+    irq_set_exclusive_handler(PIO0_IRQ_0, scan_change_handler);
+    irq_set_enabled(PIO0_IRQ_0, true);
+#else
+    // Two channels, each writing whole sweeps into its own buffer and chaining to the other.
+    // The write ring wraps each one back to the start of its buffer ready for next time.
+    sweep_dma[0] = dma_claim_unused_channel(true);
+    sweep_dma[1] = dma_claim_unused_channel(true);
+
+    for(auto i = 0u; i < 2; i++) {
+        dma_channel_config dma_config = dma_channel_get_default_config(sweep_dma[i]);
+        channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_8);
+        channel_config_set_bswap(&dma_config, false);
+        channel_config_set_read_increment(&dma_config, false);
+        channel_config_set_write_increment(&dma_config, true);
+        channel_config_set_ring(&dma_config, true, __builtin_ctz(PICADE_SCAN_BYTES)); // Wrap at one sweep
+
+        channel_config_set_dreq(&dma_config, pio_get_dreq(pio, sm, false));
+
+        channel_config_set_chain_to(&dma_config, sweep_dma[1 - i]);
+
+        dma_channel_configure(sweep_dma[i],
+            &dma_config,
+            picade_sweep[i],
+            &pio->rxf[sm],
+            PICADE_SCAN_BYTES,
+            false
+        );
+        dma_channel_set_irq1_enabled(sweep_dma[i], true);
+    }
+
+    // DMA_IRQ_0 belongs to the LED refresh
+    irq_set_exclusive_handler(DMA_IRQ_1, sweep_dma_handler);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    dma_channel_start(sweep_dma[0]);
+#endif
 
     pio_sm_set_enabled(pio, sm, true);
 }
 
+
 // This serves to debounce the falling edge of buttons,
 // particarly the joystick which can show contact bounce within the first 2ms
 // A rising edge is always reported instantly, meaning latency is never affected by debounce
 // however this short rolloff means- if you were some kind of superhuman or hooked your Picade to a signal generator-
 // it cannot report button transitions faster than roughly debounce_depth milliseconds.
 const uint debounce_depth = 5;  // How many reports- ostensibly milliseconds- before a low button should be reported as low
-uint64_t debounce_fifo[debounce_depth][8] = {0};
+uint8_t debounce_fifo[debounce_depth][board.mux_rows] = {0};  // One byte per mux row, as scanned
 uint debounce_fifo_idx = 0;
+uint debounce_window = debounce_depth;  // How many of the newest FIFO entries are merged
+
+#ifdef PICADE_ADAPTIVE_DEBOUNCE
+// Keep reporting after a change until the longest possible window has run out
+const uint debounce_settle_reports = PICADE_DEBOUNCE_MAX;
+#else
+const uint debounce_settle_reports = debounce_depth;
+#endif
+
+uint8_t input_debug[PICADE_SCAN_BYTES] = {0};
+
+// Gathers buttons into consecutive bits, in table order. With a constexpr table and
+// count this unrolls into a fixed run of shifts and masks.
+static inline uint16_t map_buttons(const uint8_t *input, const board_input_t *buttons, size_t count) {
+    uint16_t result = 0;
+    for(auto i = 0u; i < count; i++) {
+        result |= ((input[buttons[i].row] >> buttons[i].line) & 0b1) << i;
+    }
+    return result;
+}
 
-uint8_t input_debug[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+bool PICADE_HOT(picade_input_pending)() {
+#ifdef PICADE_SCAN_CHANGE_IRQ
+    // Run on every change, then for long enough afterwards to let a release clear the debounce FIFO
+    if(scan_changed) {
+        scan_changed = false;
+        debounce_settle = debounce_settle_reports;
+        return true;
+    }
+    if(debounce_settle) {
+        debounce_settle--;
+        return true;
+    }
+    return false;
+#else
+    return true;
+#endif
+}
 
-static inline uint16_t map_button(uint8_t *input, uint8_t index, uint8_t byte, uint8_t bit) {
-    // Index is the bit index of the button in the 16-bit button map
-    uint16_t button = (input[byte] >> bit) & 0b1;
-    button <<= index;
-    return button;
+void picade_set_low_power(bool enable) {
+    // While the host sleeps all we need is to spot the first press for remote wakeup,
+    // so scan slowly and skip the release debounce altogether
+    pio_sm_set_clkdiv_int_frac(pio0, scan_sm, enable ? scan_low_power_div : scan_div, 0);
+    debounce_window = enable ? 1 : debounce_depth;
 }
 
-input_t picade_get_input() {
+void picade_inject_input(const uint8_t *data) {
+    input_source = data;
+}
+
+picade_scan_stats_t picade_get_scan_stats() {
+    picade_scan_stats_t stats = scan_stats;
+    stats.sweeps = sweep_sequence;
+    return stats;
+}
+
+// Copy out the newest complete sweep. The buffer we're reading only gets written
+// again once the sweep after it completes, so if the sequence hasn't moved by the
+// time the copy is done, the copy is whole. The chained DMA starts on our buffer a
+// little before its interrupt bumps the sequence, but the first byte of a sweep is
+// a mux settle and a PIO read away, far longer than the interrupt takes.
+static inline void PICADE_HOT(picade_snapshot)(uint8_t *sweep) {
+    uint32_t sequence;
+    while(true) {
+        sequence = sweep_sequence;
+        __compiler_memory_barrier();
+        const uint8_t *latest = picade_sweep[(sequence - 1) & 1];
+        for(auto i = 0u; i < PICADE_SCAN_BYTES; i++) {
+            sweep[i] = latest[i];
+        }
+        __compiler_memory_barrier();
+        if(sweep_sequence == sequence) break;
+        scan_stats.retries++;
+    }
+
+    // Reading faster than the scan sweeps shows up as repeats, falling behind as skips
+    uint32_t elapsed = sequence - last_sweep_sequence;
+    if(elapsed == 0) {
+        scan_stats.repeated++;
+    } else {
+        scan_stats.skipped += elapsed - 1;
+    }
+    last_sweep_sequence = sequence;
+}
+
+input_t PICADE_HOT(picade_get_input)() {
     static input_t last_in = {0, 0, 0, 0, 0, 0, 0, false};
     input_t in = {0, 0, 0, 0, 0, 0, 0, false};
-    uint8_t input_data[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    uint8_t input_data[board.mux_rows] = {0};
+    uint8_t sweep[PICADE_SCAN_BYTES];
 
-    for(auto i = 0u; i < 8; i++) {
-        debounce_fifo[debounce_fifo_idx][i] = picade_input_data[i];
+    if(input_source) {
+        for(auto i = 0u; i < PICADE_SCAN_BYTES; i++) {
+            sweep[i] = input_source[i];
+        }
+    } else {
+        picade_snapshot(sweep);
     }
-    debounce_fifo_idx++;
-    debounce_fifo_idx %= debounce_depth;
 
-    for(auto i = 0u; i < 8; i++) {
-        input_debug[i] = picade_input_data[i];
+    for(auto i = 0u; i < PICADE_SCAN_BYTES; i++) {
+        input_debug[i] = sweep[i];
     }
 
+#ifdef PICADE_ADAPTIVE_DEBOUNCE
+    debounce_update(sweep, input_data, debounce_window > 1);
+#else
+    for(auto i = 0u; i < board.mux_rows; i++) {
+        debounce_fifo[debounce_fifo_idx][i] = sweep[i];
+    }
+    debounce_fifo_idx++;
+    debounce_fifo_idx %= debounce_depth;
+
     // By merging the input data with the previous FIFO entries
     // a button will have to read low for the entire FIFO depth
     // before it is *reported* low.
     // This means that rise time - button press - is *instant*
     // and fall time - button release - is debounced.
-    for(auto i = 0u; i < debounce_depth; i++) {
-        for(auto j = 0u; j < 8; j++) {
-            input_data[j] |= debounce_fifo[i][j];
+    for(auto i = 0u; i < debounce_window; i++) {
+        auto idx = (debounce_fifo_idx + debounce_depth - 1 - i) % debounce_depth;
+        for(auto j = 0u; j < board.mux_rows; j++) {
+            input_data[j] |= debounce_fifo[idx][j];
         }
     }
-
-    // Player 1, 12 buttons, 4 directions
-    in.p1 |= (input_data[4] & 0x0f) << 12;     // joystick
-    in.p1 |= map_button(input_data, 0,  0, 1); // A
-    in.p1 |= map_button(input_data, 1,  0, 2); // B
-    in.p1 |= map_button(input_data, 2,  0, 3); // X
-    in.p1 |= map_button(input_data, 3,  1, 0); // Y
-    in.p1 |= map_button(input_data, 4,  0, 0); // Start
-    in.p1 |= map_button(input_data, 5,  2, 1); // Select
-    in.p1 |= map_button(input_data, 6,  1, 1); // L1
-    in.p1 |= map_button(input_data, 7,  1, 3); // R1
-    in.p1 |= map_button(input_data, 8,  1, 2); // L2
-    in.p1 |= map_button(input_data, 9,  2, 0); // R2
-    in.p1 |= map_button(input_data, 10, 2, 2); // L3
-    in.p1 |= map_button(input_data, 11, 2, 3); // R3
-
-    // Player 2, 12 buttons, 4 directions
-    in.p2 |= (input_data[4] & 0xf0) << 8;      // joystick
-    in.p2 |= map_button(input_data, 0,  2, 7); // A
-    in.p2 |= map_button(input_data, 1,  3, 4); // B
-    in.p2 |= map_button(input_data, 2,  3, 5); // X
-    in.p2 |= map_button(input_data, 3,  3, 6); // Y
-    in.p2 |= map_button(input_data, 4,  2, 6); // Start
-    in.p2 |= map_button(input_data, 5,  1, 4); // Select
-    in.p2 |= map_button(input_data, 6,  0, 4); // L1
-    in.p2 |= map_button(input_data, 7,  0, 6); // R1
-    in.p2 |= map_button(input_data, 8,  0, 5); // L2
-    in.p2 |= map_button(input_data, 9,  0, 7); // R2
-    in.p2 |= map_button(input_data, 10, 1, 5); // L3
-    in.p2 |= map_button(input_data, 11, 1, 6); // R3
-
-    // Six util buttons
-    in.util |= map_button(input_data, 0, 3, 0); // P1 Hotkey
-    in.util |= map_button(input_data, 1, 1, 7); // P2 Hotkey
-    in.util |= map_button(input_data, 2, 3, 1); // P1 X1
-    in.util |= map_button(input_data, 3, 3, 2); // P1 X2
-    in.util |= map_button(input_data, 4, 2, 4); // P2 X1
-    in.util |= map_button(input_data, 5, 2, 5); // P2 X2
+#endif
+
+    // Buttons in the low bits, joystick directions in the top nibble
+    in.p1 = map_buttons(input_data, board.p1, board.player_buttons);
+    in.p1 |= (input_data[board.joystick_row] & 0x0f) << 12;
+    in.p2 = map_buttons(input_data, board.p2, board.player_buttons);
+    in.p2 |= (input_data[board.joystick_row] & 0xf0) << 8;
+    in.util = map_buttons(input_data, board.util, board.util_buttons);
 
     if(in.p1 & JOYSTICK_LEFT) {in.p1_x = -127;}
     if(in.p1 & JOYSTICK_RIGHT){in.p1_x =  127;}
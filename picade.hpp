@@ -1,10 +1,17 @@
+#pragma once
 #include "pico/stdlib.h"
+#include "board.hpp"
 
 const int16_t JOYSTICK_LEFT  = 0b1000000000000000;
 const int16_t JOYSTICK_RIGHT = 0b0100000000000000;
 const int16_t JOYSTICK_DOWN  = 0b0010000000000000;
 const int16_t JOYSTICK_UP    = 0b0001000000000000;
-const int16_t BUTTON_MASK    = 0b0000111111111111;
+const uint16_t BUTTON_MASK   = (1u << board.player_buttons) - 1;  // The player's buttons, below the joystick
+
+// In the gamepad report each player's hotkey, X1 and X2 follow straight on from their buttons
+const uint16_t GAMEPAD_HOTKEY = 1u << board.player_buttons;
+const uint16_t GAMEPAD_X1     = 1u << (board.player_buttons + 1);
+const uint16_t GAMEPAD_X2     = 1u << (board.player_buttons + 2);
 
 const uint8_t UTIL_P1_HOTKEY = 0b000001;
 const uint8_t UTIL_P2_HOTKEY = 0b000010;
@@ -13,6 +20,9 @@ const uint8_t UTIL_P1_X2     = 0b001000;
 const uint8_t UTIL_P2_X1     = 0b010000;
 const uint8_t UTIL_P2_X2     = 0b100000;
 
+// Bytes per sweep of the scan, as DMA'd into the sweep buffers
+const size_t PICADE_SCAN_BYTES = board.sweep_bytes();
+
 struct input_t {
     uint16_t p1;
     uint16_t p2;
@@ -30,4 +40,25 @@ bool operator!=(const input_t& lhs, const input_t& rhs);
 void picade_init();
 input_t picade_get_input();
 
-extern uint8_t input_debug[8];
\ No newline at end of file
+// With PICADE_SCAN_CHANGE_IRQ the scan raises an interrupt only when a line changes,
+// this is false whenever a call to picade_get_input() would report nothing new.
+// Otherwise it is always true.
+bool picade_input_pending();
+
+struct picade_scan_stats_t {
+    uint32_t sweeps;    // Complete sweeps (with PICADE_SCAN_CHANGE_IRQ, sweeps that changed)
+    uint32_t repeated;  // Reads that got the same sweep as the read before
+    uint32_t skipped;   // Sweeps that completed between reads and were never seen
+    uint32_t retries;   // Reads redone because a new sweep completed mid-copy
+};
+
+picade_scan_stats_t picade_get_scan_stats();
+
+// Drop to a slow scan with minimal debounce while USB is suspended
+void picade_set_low_power(bool enable);
+
+// Feed picade_get_input() from a PICADE_SCAN_BYTES buffer in place of the scanned input,
+// pass nullptr to go back to the hardware scan.
+void picade_inject_input(const uint8_t *data);
+
+extern uint8_t input_debug[PICADE_SCAN_BYTES];
\ No newline at end of file
@@ -1,74 +1,375 @@
 #include "plasma.hpp"
+#include "hotpath.hpp"
 #include "hardware/spi.h"
 #include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "pico/sync.h"
+
+#ifdef PLASMA_BACKEND_PIO
+#include "hardware/pio.h"
+#include "apa102.pio.h"
+#endif
 
 // TODO I count 30 inputs on the board- 12 per player + 6 util so we're probably OK with 32 buttons * 4 LEDs * 4 bytes?
-uint8_t led_buffer[32 * 4 * 4] = {0};
-uint8_t led_front_buffer[32 * 4 * 4] = {0};
+// Two APA102 buffers: one being clocked out by DMA, one for the next frame to be built in.
+// They only ever swap between refreshes, in dma_handler(), so a frame is never shown torn.
+#ifdef PLASMA_BACKEND_PIO
+// apa102_parallel reads each frame's length from its first word, so that word is kept at
+// the front of each buffer and goes through the FIFO in order with the frame it describes
+const size_t PLASMA_FRAME_PREFIX = 4;
+#else
+const size_t PLASMA_FRAME_PREFIX = 0;
+#endif
+uint8_t led_buffer[2][PLASMA_FRAME_PREFIX + board.led_bytes()] __attribute__((aligned(4))) = {0};
+uint8_t led_front_buffer[board.led_bytes()] = {0};
+
+// With several PIO chains frames are built here, then bit-interleaved into led_buffer
+uint8_t led_scratch[PLASMA_PIO_CHAINS > 1 ? sizeof(led_front_buffer) : 1] = {0};
+
+volatile uint led_display = 0;       // Which led_buffer DMA is reading
+volatile bool led_pending = false;   // The other led_buffer holds a frame waiting to be latched
+
+volatile plasma_stats_t plasma_stats = {0, 0, 0, 0, 0, 0};
+
+struct plasma_frame_t {
+    uint32_t present_at_us;
+    uint8_t data[sizeof(led_front_buffer)];
+};
+
+// One spare slot, so a frame can be received into the queue without evicting
+// anything until it is actually committed
+const size_t PLASMA_QUEUE_SLOTS = PLASMA_QUEUE_DEPTH + 1;
+plasma_frame_t plasma_queue[PLASMA_QUEUE_SLOTS];
+uint plasma_queue_head = 0;
+uint plasma_queue_count = 0;
 
+#ifndef PLASMA_BACKEND_PIO
 // TODO these might need dialling in but seem okay on my 4x4 rig
-uint8_t apa102_sof[8] = {0x00};
-uint8_t apa102_eof[8] = {0xff};
+// 32 zero bits start a frame, and the end frame needs one clock edge per two LEDs
+// to push the last of the data through. dma_handler sends both, so they sit in SRAM
+// with it. The end frame is all ones, plasma_output_init() fills it.
+const uint8_t PICADE_HOT_SECTION(apa102_sof) apa102_sof[4] = {0x00};
+uint8_t PICADE_HOT_SECTION(apa102_eof) apa102_eof[(board.num_leds / 2 + 7) / 8];
+#endif
 
 // Say no to magic numbers
 const uint8_t APA102_SOF = 0b11100000;
 
-uint spi_channel = 0;
+uint led_channel = 0;
+bool plasma_suspended = false;
+bool plasma_running = false;   // plasma_init() can be deferred, nothing to suspend until then
 
-void dma_handler() {
-    if(dma_irqn_get_channel_status(0, spi_channel)){
-        dma_irqn_acknowledge_channel(0, spi_channel);
+#ifdef PLASMA_BACKEND_PIO
+static_assert(PLASMA_PIO_CHAINS == 1 || PLASMA_PIO_CHAINS == 2 || PLASMA_PIO_CHAINS == 4,
+              "PLASMA_PIO_CHAINS must divide a 32-bit word evenly and fit the free pins");
+static_assert(PLASMA_DATA + PLASMA_PIO_CHAINS <= 30, "Data pins run past GPIO 29, the last on the RP2040");
+static_assert(sizeof(led_front_buffer) / 4 % PLASMA_PIO_CHAINS == 0, "LEDs must split evenly across chains");
+
+PIO led_pio = nullptr;
+uint led_sm = 0;
+uint led_offset = 0;
+uint16_t apa102_instructions[32];
+
+// Bit times in one refresh, each clocks one bit out to every chain at once
+const uint32_t apa102_bit_times = sizeof(led_front_buffer) * 8 / PLASMA_PIO_CHAINS;
+#endif
+
+// Spread `len` bytes of APA102 data, PLASMA_PIO_CHAINS chains back to back, into the
+// stream apa102_parallel shifts out: one bit per chain per clock, MSB first.
+void PICADE_HOT(plasma_interleave)(uint8_t *dst, const uint8_t *src, size_t len) {
+    const size_t chain_len = len / PLASMA_PIO_CHAINS;
+    memset(dst, 0, len);
+    for(auto c = 0u; c < PLASMA_PIO_CHAINS; c++) {
+        for(auto i = 0u; i < chain_len; i++) {
+            uint8_t byte = src[c * chain_len + i];
+            for(auto b = 0u; b < 8; b++) {
+                if(byte & (0b10000000 >> b)) {
+                    // The first bit out of each group lands on the highest data pin
+                    size_t p = (i * 8 + b) * PLASMA_PIO_CHAINS + (PLASMA_PIO_CHAINS - 1 - c);
+                    dst[p / 8] |= 0b10000000 >> (p % 8);
+                }
+            }
+        }
+    }
+}
+
+// Refresh boundary, the only safe place to latch a new frame
+void PICADE_HOT(plasma_latch)() {
+    if(led_pending) {
+        led_display = 1 - led_display;
+        led_pending = false;
+        plasma_stats.presented++;
+        plasma_stats.last_present_us = time_us_32();
+    }
+}
+
+void PICADE_HOT(dma_handler)() {
+    if(dma_irqn_get_channel_status(0, led_channel)){
+        uint32_t t = time_us_32();
+        dma_irqn_acknowledge_channel(0, led_channel);
+        plasma_stats.refreshes++;
+#ifdef PLASMA_BACKEND_PIO
+        // PIO adds its own start/end frames, and the length leads each buffer
+        plasma_latch();
+#else
         spi_write_blocking(spi0, apa102_eof, sizeof(apa102_eof));
+        plasma_latch();
         spi_write_blocking(spi0, apa102_sof, sizeof(apa102_sof));
-        dma_channel_set_read_addr(spi_channel, led_buffer, true);
+#endif
+        dma_channel_set_read_addr(led_channel, led_buffer[led_display], true);
+        plasma_stats.irq_us += time_us_32() - t;
     }
 }
 
-void plasma_init() {
-    plasma_set_all(0, 0, 0);
+// Take the back buffer away from dma_handler() before writing to it.
+// If it was still waiting to be latched that frame is lost.
+uint8_t *PICADE_HOT(plasma_begin_frame)() {
+    uint32_t status = save_and_disable_interrupts();
+    if(led_pending) {
+        led_pending = false;
+        plasma_stats.dropped++;
+    }
+    uint8_t *buffer = PLASMA_PIO_CHAINS > 1 ? led_scratch : led_buffer[1 - led_display] + PLASMA_FRAME_PREFIX;
+    restore_interrupts(status);
+    return buffer;
+}
+
+void PICADE_HOT(plasma_end_frame)() {
+    if(PLASMA_PIO_CHAINS > 1) {
+        plasma_interleave(led_buffer[1 - led_display] + PLASMA_FRAME_PREFIX, led_scratch, sizeof(led_scratch));
+    }
+    __compiler_memory_barrier();
+    led_pending = true;
+}
 
+void PICADE_HOT(plasma_present)(const uint8_t *frame) {
+    /*
+    Plasma is     SOF B G R
+    Multiverse is B G R _
+    */
+    uint8_t *buffer = plasma_begin_frame();
+    for(auto x = 0u; x < sizeof(led_front_buffer); x += 4) {
+        buffer[x + 0] = APA102_SOF | frame[x + 3];
+        buffer[x + 1] = frame[x + 0];
+        buffer[x + 2] = frame[x + 1];
+        buffer[x + 3] = frame[x + 2];
+    }
+    plasma_end_frame();
+}
+
+#ifdef PLASMA_BACKEND_PIO
+void plasma_output_init() {
+    // Share a PIO with picade_scan if there's room, otherwise take the other one
+    pio_program_t program = apa102_parallel_program;
+    memcpy(apa102_instructions, program.instructions, program.length * sizeof(uint16_t));
+    apa102_instructions[apa102_parallel_offset_data] = pio_encode_out(pio_pins, PLASMA_PIO_CHAINS) | pio_encode_sideset(1, 0);
+    program.instructions = apa102_instructions;
+
+    led_pio = pio_can_add_program(pio0, &program) ? pio0 : pio1;
+    led_sm = pio_claim_unused_sm(led_pio, true);
+    led_offset = pio_add_program(led_pio, &program);
+
+    pio_gpio_init(led_pio, PLASMA_CLOCK);
+    for(auto c = 0u; c < PLASMA_PIO_CHAINS; c++) {
+        pio_gpio_init(led_pio, PLASMA_DATA + c);
+    }
+    pio_sm_set_consecutive_pindirs(led_pio, led_sm, PLASMA_CLOCK, 1, true);
+    pio_sm_set_consecutive_pindirs(led_pio, led_sm, PLASMA_DATA, PLASMA_PIO_CHAINS, true);
+
+    pio_sm_config config = apa102_parallel_program_get_default_config(led_offset);
+    sm_config_set_out_pins(&config, PLASMA_DATA, PLASMA_PIO_CHAINS);
+    sm_config_set_sideset_pins(&config, PLASMA_CLOCK);
+    // MSB first, the DMA byte swaps each word so the buffer reads as a plain byte stream
+    sm_config_set_out_shift(&config, false, true, 32);
+    sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+    // Two instructions per bit
+    sm_config_set_clkdiv(&config, (float)clock_get_hz(clk_sys) / (2 * PLASMA_PIO_HZ));
+    pio_sm_init(led_pio, led_sm, led_offset, &config);
+    pio_sm_set_enabled(led_pio, led_sm, true);
+
+    led_channel = dma_claim_unused_channel(true);
+    dma_channel_config led_config = dma_channel_get_default_config(led_channel);
+    channel_config_set_transfer_data_size(&led_config, DMA_SIZE_32);
+    channel_config_set_bswap(&led_config, true);
+    channel_config_set_dreq(&led_config, pio_get_dreq(led_pio, led_sm, true));
+    channel_config_set_write_increment(&led_config, false);
+
+    dma_channel_set_irq0_enabled(led_channel, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, dma_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    // Big-endian, the DMA byte swap turns it back into the bit count
+    for(auto &buffer : led_buffer) {
+        buffer[0] = ((apa102_bit_times - 1) >> 24) & 0xff;
+        buffer[1] = ((apa102_bit_times - 1) >> 16) & 0xff;
+        buffer[2] = ((apa102_bit_times - 1) >> 8) & 0xff;
+        buffer[3] = (apa102_bit_times - 1) & 0xff;
+    }
+
+    dma_channel_configure(led_channel, &led_config,
+                          &led_pio->txf[led_sm],
+                          led_buffer[led_display],
+                          sizeof(led_buffer[0]) / sizeof(uint32_t),
+                          true);
+}
+
+// Clock out one all-off frame with the refresh loop stopped
+void plasma_output_blank() {
+    uint8_t dark[4 * PLASMA_PIO_CHAINS];
+    uint8_t dark_interleaved[sizeof(dark)];
+    for(auto x = 0u; x < sizeof(dark); x += 4) {
+        dark[x + 0] = APA102_SOF;
+        dark[x + 1] = dark[x + 2] = dark[x + 3] = 0;
+    }
+    plasma_interleave(dark_interleaved, dark, sizeof(dark));
+
+    // The aborted DMA left the state machine part way through a frame, start it afresh
+    pio_sm_set_enabled(led_pio, led_sm, false);
+    pio_sm_clear_fifos(led_pio, led_sm);
+    pio_sm_restart(led_pio, led_sm);
+    pio_sm_exec(led_pio, led_sm, pio_encode_jmp(led_offset));
+    pio_sm_set_enabled(led_pio, led_sm, true);
+
+    pio_sm_put_blocking(led_pio, led_sm, apa102_bit_times - 1);
+    for(auto x = 0u; x < sizeof(led_front_buffer); x += sizeof(dark)) {
+        for(auto w = 0u; w < sizeof(dark); w += 4) {
+            // Same byte order the DMA would have produced
+            uint32_t word = dark_interleaved[w] << 24 | dark_interleaved[w + 1] << 16 | dark_interleaved[w + 2] << 8 | dark_interleaved[w + 3];
+            pio_sm_put_blocking(led_pio, led_sm, word);
+        }
+    }
+}
+
+void plasma_output_start() {
+    // Nothing to do, the first word the DMA sends is the frame length
+}
+#else
+void plasma_output_init() {
     spi_init(spi0, 2 * 1000 * 1000);
     gpio_set_function(PLASMA_CLOCK, GPIO_FUNC_SPI);
     gpio_set_function(PLASMA_DATA, GPIO_FUNC_SPI);
 
+    memset(apa102_eof, 0xff, sizeof(apa102_eof));
     spi_write_blocking(spi0, apa102_sof, sizeof(apa102_sof));
 
-    spi_channel = dma_claim_unused_channel(true);
-    dma_channel_config spi_config = dma_channel_get_default_config(spi_channel);
+    led_channel = dma_claim_unused_channel(true);
+    dma_channel_config spi_config = dma_channel_get_default_config(led_channel);
     channel_config_set_transfer_data_size(&spi_config, DMA_SIZE_8);
     channel_config_set_dreq(&spi_config, spi_get_dreq(spi0, true));
     channel_config_set_write_increment(&spi_config, false);
     //channel_config_set_ring(&spi_config, false, 9); // Wrap at 512 bytes
 
-    dma_channel_set_irq0_enabled(spi_channel, true);
+    dma_channel_set_irq0_enabled(led_channel, true);
     irq_set_exclusive_handler(DMA_IRQ_0, dma_handler);
     irq_set_enabled(DMA_IRQ_0, true);
 
-    dma_channel_configure(spi_channel, &spi_config,
+    dma_channel_configure(led_channel, &spi_config,
                           &spi_get_hw(spi0)->dr,
-                          led_buffer,
-                          sizeof(led_buffer),
+                          led_buffer[led_display],
+                          sizeof(led_buffer[0]),
                           true);
 }
 
-void plasma_flip() {
-    /*
-    Plasma is     SOF B G R
-    Multiverse is B G R _
-    */
-    for(auto x = 0u; x < sizeof(led_buffer); x += 4) {
-        led_buffer[x + 0] = APA102_SOF | led_front_buffer[x + 3];
-        led_buffer[x + 1] = led_front_buffer[x + 0];
-        led_buffer[x + 2] = led_front_buffer[x + 1];
-        led_buffer[x + 3] = led_front_buffer[x + 2];
+// Close out whatever frame was cut short, then send one all-off frame
+void plasma_output_blank() {
+    const uint8_t dark[4] = {APA102_SOF, 0, 0, 0};
+    spi_write_blocking(spi0, apa102_eof, sizeof(apa102_eof));
+    spi_write_blocking(spi0, apa102_sof, sizeof(apa102_sof));
+    for(auto x = 0u; x < sizeof(led_front_buffer); x += 4) {
+        spi_write_blocking(spi0, dark, sizeof(dark));
     }
+    spi_write_blocking(spi0, apa102_eof, sizeof(apa102_eof));
+}
+
+void plasma_output_start() {
+    spi_write_blocking(spi0, apa102_sof, sizeof(apa102_sof));
+}
+#endif
+
+void plasma_init() {
+    // Nothing is on display yet, so start both buffers dark
+    plasma_set_all(0, 0, 0);
+    memcpy(led_buffer[led_display], led_buffer[1 - led_display], sizeof(led_buffer[0]));
+    led_pending = false;
+
+    plasma_output_init();
+    plasma_running = true;
+}
+
+void PICADE_HOT(plasma_flip)() {
+    plasma_present(led_front_buffer);
 }
 
 void plasma_set_all(uint8_t r, uint8_t g, uint8_t b, uint8_t brightness) {
-    for(auto x = 0u; x < sizeof(led_buffer); x += 4) {
-        led_buffer[x + 0] = APA102_SOF | brightness;
-        led_buffer[x + 1] = b;
-        led_buffer[x + 2] = g;
-        led_buffer[x + 3] = r;
+    uint8_t *buffer = plasma_begin_frame();
+    for(auto x = 0u; x < sizeof(led_front_buffer); x += 4) {
+        buffer[x + 0] = APA102_SOF | brightness;
+        buffer[x + 1] = b;
+        buffer[x + 2] = g;
+        buffer[x + 3] = r;
+    }
+    plasma_end_frame();
+}
+
+// Stop the refresh loop and leave the chain dark, for USB suspend
+void plasma_suspend() {
+    if(plasma_suspended || !plasma_running) return;
+    plasma_suspended = true;
+
+    dma_channel_set_irq0_enabled(led_channel, false);
+    dma_channel_abort(led_channel);
+    dma_irqn_acknowledge_channel(0, led_channel);
+
+    plasma_output_blank();
+}
+
+void plasma_resume() {
+    if(!plasma_suspended) return;
+    plasma_suspended = false;
+
+    // Pick up anything that arrived while we were suspended
+    plasma_latch();
+
+    plasma_output_start();
+    dma_channel_set_irq0_enabled(led_channel, true);
+    dma_channel_set_read_addr(led_channel, led_buffer[led_display], true);
+}
+
+uint8_t *plasma_queue_reserve() {
+    return plasma_queue[(plasma_queue_head + plasma_queue_count) % PLASMA_QUEUE_SLOTS].data;
+}
+
+void plasma_queue_commit(uint32_t present_at_us) {
+    plasma_queue[(plasma_queue_head + plasma_queue_count) % PLASMA_QUEUE_SLOTS].present_at_us = present_at_us;
+    if(plasma_queue_count == PLASMA_QUEUE_DEPTH) {
+        plasma_queue_head = (plasma_queue_head + 1) % PLASMA_QUEUE_SLOTS;
+        plasma_queue_count--;
+        plasma_stats.dropped++;
     }
+    plasma_queue_count++;
+}
+
+void PICADE_HOT(plasma_task)() {
+    // Hand over every queued frame that has come due, the next refresh latches the newest
+    while(plasma_queue_count) {
+        plasma_frame_t &frame = plasma_queue[plasma_queue_head];
+        if((int32_t)(time_us_32() - frame.present_at_us) < 0) break;
+        plasma_present(frame.data);
+        plasma_queue_head = (plasma_queue_head + 1) % PLASMA_QUEUE_SLOTS;
+        plasma_queue_count--;
+    }
+}
+
+plasma_stats_t plasma_get_stats() {
+    uint32_t status = save_and_disable_interrupts();
+    plasma_stats_t stats = {
+        plasma_stats.refreshes,
+        plasma_stats.presented,
+        plasma_stats.dropped,
+        plasma_stats.last_present_us,
+        plasma_queue_count,
+        plasma_stats.irq_us
+    };
+    restore_interrupts(status);
+    return stats;
 }
@@ -1,9 +1,46 @@
+#pragma once
 #include "pico/stdlib.h"
+#include "board.hpp"
 
 const uint PLASMA_CLOCK = 22;
 const uint PLASMA_DATA = 23;
-extern uint8_t led_front_buffer[32 * 4 * 4];
+extern uint8_t led_front_buffer[board.led_bytes()];
+
+// PLASMA_BACKEND_PIO swaps spi0 for a PIO program that clocks PLASMA_PIO_CHAINS
+// chains in parallel, on data pins PLASMA_DATA upwards with a shared PLASMA_CLOCK.
+// The LEDs are split evenly between the chains, in order.
+// This firmware uses no GPIO above PLASMA_DATA (23), leaving 24-29 for extra chains,
+// so up to 4 chains (GPIO 23-26). Check the board wiring before using more than one.
+#ifndef PLASMA_PIO_CHAINS
+#define PLASMA_PIO_CHAINS 1
+#endif
+
+#ifndef PLASMA_PIO_HZ
+#define PLASMA_PIO_HZ (8 * 1000 * 1000)
+#endif
+
+// How many frames the host can queue ahead with plasma_queue_reserve()
+const size_t PLASMA_QUEUE_DEPTH = 4;
+
+struct plasma_stats_t {
+    uint32_t refreshes;        // Complete passes over the LED chain
+    uint32_t presented;        // Frames latched at a refresh boundary
+    uint32_t dropped;          // Frames replaced before they were ever latched
+    uint32_t last_present_us;  // time_us_32() of the most recent latch
+    uint32_t queued;           // Frames waiting in the queue
+    uint32_t irq_us;           // Total time spent in the refresh interrupt
+};
 
 void plasma_init();
 void plasma_set_all(uint8_t r, uint8_t g, uint8_t b, uint8_t brightness=31);
-void plasma_flip();
\ No newline at end of file
+void plasma_flip();
+void plasma_task();
+void plasma_suspend();
+void plasma_resume();
+plasma_stats_t plasma_get_stats();
+
+// Timed presentation: fill the returned buffer (led_front_buffer layout) and commit it
+// with the time_us_32() it should go out at. Committing to a full queue drops its oldest
+// frame, a reserved buffer that is never committed costs nothing.
+uint8_t *plasma_queue_reserve();
+void plasma_queue_commit(uint32_t present_at_us);
@@ -0,0 +1,58 @@
+#include "replay.hpp"
+
+replay_step_t replay_steps[REPLAY_MAX_STEPS];
+replay_event_t replay_events[REPLAY_MAX_EVENTS];
+size_t replay_event_count = 0;
+
+size_t replay_step_count = 0;
+size_t replay_step_idx = 0;
+uint32_t replay_start_us = 0;
+bool replay_active = false;
+
+void replay_start(size_t step_count) {
+    // Don't leave input_source on a step of the old script, even if there's no new one
+    replay_stop();
+    replay_step_count = std::min(step_count, REPLAY_MAX_STEPS);
+    replay_step_idx = 0;
+    replay_event_count = 0;
+    replay_start_us = time_us_32();
+    replay_active = replay_step_count > 0;
+}
+
+void replay_stop() {
+    picade_inject_input(nullptr);
+    replay_active = false;
+}
+
+bool replay_running() {
+    return replay_active;
+}
+
+void replay_task() {
+    if(!replay_active) return;
+
+    uint32_t t = time_us_32() - replay_start_us;
+
+    // Apply every step that has come due, the last one wins
+    while(replay_step_idx < replay_step_count && replay_steps[replay_step_idx].time_us <= t) {
+        picade_inject_input(replay_steps[replay_step_idx].input);
+        replay_step_idx++;
+    }
+
+    // Once the script is exhausted hold the final state briefly, then hand back to the hardware scan
+    if(replay_step_idx == replay_step_count
+    && t >= replay_steps[replay_step_count - 1].time_us + REPLAY_TAIL_US) {
+        replay_stop();
+    }
+}
+
+void replay_record(const input_t &in) {
+    if(!replay_active || replay_event_count >= REPLAY_MAX_EVENTS) return;
+
+    replay_event_t &event = replay_events[replay_event_count++];
+    event.time_us = time_us_32() - replay_start_us;
+    event.p1 = in.p1;
+    event.p2 = in.p2;
+    event.util = in.util;
+    event.step = replay_step_idx ? replay_step_idx - 1 : 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <algorithm>
+#include "pico/stdlib.h"
+#include "picade.hpp"
+
+// One step of an input script: the raw scan bytes to inject,
+// applied `time_us` microseconds after the script starts.
+struct replay_step_t {
+    uint32_t time_us;
+    uint8_t input[PICADE_SCAN_BYTES];
+};
+
+// One HID report that carried an input change while a script was running.
+struct replay_event_t {
+    uint32_t time_us;   // When the last gamepad report carrying it was queued, relative to script start
+    uint16_t p1;
+    uint16_t p2;
+    uint8_t util;
+    uint8_t step;       // Index of the last step applied before this report
+    uint8_t _pad[2];
+};
+
+const size_t REPLAY_MAX_STEPS = 128;
+const size_t REPLAY_MAX_EVENTS = 128;
+
+// How long to keep injecting the final step so its report is captured
+const uint32_t REPLAY_TAIL_US = 50 * 1000;
+
+extern replay_step_t replay_steps[REPLAY_MAX_STEPS];
+extern replay_event_t replay_events[REPLAY_MAX_EVENTS];
+extern size_t replay_event_count;
+
+// Starting a script, or stopping one, always hands input back to the hardware scan first
+void replay_start(size_t step_count);
+void replay_stop();
+void replay_task();
+void replay_record(const input_t &in);
+bool replay_running();
@@ -0,0 +1,117 @@
+#include "telemetry.hpp"
+#include "hotpath.hpp"
+#include "hardware/sync.h"
+#include "tusb.h"
+
+#include <algorithm>
+#include <cstring>
+
+static_assert((TELEMETRY_RING_SIZE & (TELEMETRY_RING_SIZE - 1)) == 0, "Telemetry ring must be a power of two");
+
+// Single producer, single consumer. Indices run free and are masked on use,
+// so head - tail is always the number of bytes waiting.
+uint8_t telemetry_ring[TELEMETRY_RING_SIZE];
+volatile uint32_t telemetry_head = 0;  // Published by telemetry_commit()
+volatile uint32_t telemetry_tail = 0;  // Advanced by telemetry_task()
+
+uint32_t telemetry_write = 0;      // Producer's private head while a record is being built
+bool telemetry_open = false;
+uint16_t telemetry_sequence = 0;
+uint32_t telemetry_last_pending = 0;
+
+telemetry_stats_t telemetry_stats = {0, 0, 0, 0};
+
+static void telemetry_copy_in(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while(len) {
+        size_t offset = telemetry_write & (TELEMETRY_RING_SIZE - 1);
+        size_t chunk = std::min(len, TELEMETRY_RING_SIZE - offset);
+        memcpy(telemetry_ring + offset, p, chunk);
+        telemetry_write += chunk;
+        p += chunk;
+        len -= chunk;
+    }
+}
+
+bool PICADE_HOT(telemetry_begin)(const char *tag, size_t length) {
+    size_t free = TELEMETRY_RING_SIZE - (telemetry_head - telemetry_tail);
+    if(sizeof(telemetry_header_t) + length > free || length > UINT16_MAX) {
+        telemetry_stats.dropped++;
+        telemetry_sequence++;
+        telemetry_open = false;
+        return false;
+    }
+
+    telemetry_header_t header;
+    memcpy(header.tag, tag, sizeof(header.tag));
+    header.length = length;
+    header.sequence = telemetry_sequence++;
+
+    telemetry_write = telemetry_head;
+    telemetry_open = true;
+    telemetry_copy_in(&header, sizeof(header));
+    return true;
+}
+
+void PICADE_HOT(telemetry_append)(const void *data, size_t len) {
+    if(telemetry_open) telemetry_copy_in(data, len);
+}
+
+void PICADE_HOT(telemetry_commit)() {
+    if(!telemetry_open) return;
+    telemetry_open = false;
+    // The record must be in the ring before the consumer can see it
+    __dmb();
+    telemetry_head = telemetry_write;
+    telemetry_stats.records++;
+}
+
+bool PICADE_HOT(telemetry_send)(const char *tag, const void *data, size_t len) {
+    if(!telemetry_begin(tag, len)) return false;
+    telemetry_append(data, len);
+    telemetry_commit();
+    return true;
+}
+
+void telemetry_task() {
+    uint32_t head = telemetry_head;
+    uint32_t pending = head - telemetry_tail;
+    if(!pending) return;
+
+    // Nobody to read it, don't let stale replies pile up for the next connection
+    if(!tud_cdc_connected()) {
+        telemetry_tail = head;
+        telemetry_last_pending = 0;
+        return;
+    }
+
+    size_t batch = std::min((size_t)pending, (size_t)tud_cdc_write_available());
+    if(batch >= TELEMETRY_PACKET) {
+        batch -= batch % TELEMETRY_PACKET;
+    } else if(batch < pending || pending != telemetry_last_pending) {
+        // Hold a short packet back for one pass in case more is on the way,
+        // and send it once the producers have gone quiet
+        telemetry_last_pending = pending;
+        return;
+    }
+    if(!batch) return;
+
+    __dmb();
+    size_t remaining = batch;
+    while(remaining) {
+        size_t offset = telemetry_tail & (TELEMETRY_RING_SIZE - 1);
+        size_t chunk = std::min(remaining, TELEMETRY_RING_SIZE - offset);
+        tud_cdc_write(telemetry_ring + offset, chunk);
+        telemetry_tail += chunk;
+        remaining -= chunk;
+    }
+    tud_cdc_write_flush();
+
+    telemetry_last_pending = head - telemetry_tail;
+    telemetry_stats.bytes += batch;
+    telemetry_stats.batches++;
+}
+
+telemetry_stats_t telemetry_get_stats() {
+    return telemetry_stats;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// Framed binary records from the device to the host over CDC.
+// Producers append whole records to a ring without ever blocking, and
+// telemetry_task() drains it into the CDC FIFO in full USB packets.
+// Each record is a telemetry_header_t followed by `length` payload bytes.
+struct telemetry_header_t {
+    char tag[4];        // What the payload is, usually the command that asked for it
+    uint16_t length;    // Payload bytes
+    uint16_t sequence;  // Incremented per record, a gap means records were dropped
+};
+
+const size_t TELEMETRY_RING_SIZE = 2048;  // Power of two, holds the largest record (rlog)
+const size_t TELEMETRY_PACKET = 64;       // Full speed bulk packet
+
+struct telemetry_stats_t {
+    uint32_t records;   // Records queued
+    uint32_t dropped;   // Records that didn't fit in the ring
+    uint32_t bytes;     // Bytes handed to the CDC FIFO
+    uint32_t batches;   // Writes to the CDC FIFO
+};
+
+// Queue a record in parts: begin with the total payload length, append the
+// payload, then commit. If begin returns false there was no room and the
+// record is dropped, append and commit are then no-ops.
+bool telemetry_begin(const char *tag, size_t length);
+void telemetry_append(const void *data, size_t len);
+void telemetry_commit();
+
+// Queue a record with a single part payload
+bool telemetry_send(const char *tag, const void *data, size_t len);
+
+void telemetry_task();
+telemetry_stats_t telemetry_get_stats();
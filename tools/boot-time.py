@@ -0,0 +1,21 @@
+import struct
+import sys
+import serial
+from telemetry import find_port, read_reply
+
+# Reads the boot milestones recorded since the Picade last reset.
+#
+# Usage: boot-time.py [port]
+
+port = find_port(sys.argv[1] if len(sys.argv) > 1 else None)
+
+# In boot_mark_t order
+MARKS = ["main", "board_init", "scan started", "usb init", "mounted", "first report", "leds started"]
+
+device = serial.Serial(port, timeout=2)
+device.write(b"multiverse:boot")
+marks = struct.unpack(f"<{len(MARKS)}I", read_reply(device, "boot"))
+device.close()
+
+for name, t in zip(MARKS, marks):
+    print(f"{name:>14} {t / 1000:9.3f} ms" if t else f"{name:>14}   not reached")
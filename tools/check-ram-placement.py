@@ -0,0 +1,75 @@
+import re
+import sys
+
+# Checks a linker map to prove functions and tables ended up in SRAM rather than XIP flash.
+# Each name can be a function/table symbol or a .time_critical.<name> section.
+#
+# Usage: check-ram-placement.py <firmware.elf.map> <name> [<name> ...]
+
+SRAM_START = 0x20000000
+SRAM_END = 0x20042000
+
+if len(sys.argv) < 3:
+    print("Usage: check-ram-placement.py <map> <name> [<name> ...]")
+    sys.exit(2)
+
+map_file = sys.argv[1]
+names = sys.argv[2:]
+
+SECTION = re.compile(r"^ (\.\S+)(?:\s+0x([0-9a-f]+)\s+0x[0-9a-f]+\s+\S.*)?$")
+SYMBOL = re.compile(r"^\s+0x([0-9a-f]+)\s+(\S.*)$")
+ADDRESS = re.compile(r"^\s+0x([0-9a-f]+)\s+0x[0-9a-f]+\s+\S")
+
+
+def matches(name, text):
+    # Plain C symbol, demangled C++ or Itanium-mangled C++
+    return text == name or text.startswith(name + "(") or f"{len(name)}{name}" in text
+
+
+found = {}
+pending_section = None
+
+with open(map_file) as f:
+    for line in f:
+        line = line.rstrip("\n")
+
+        # Long input section names wrap, the address is on the following line
+        if pending_section:
+            m = ADDRESS.match(line)
+            if m:
+                found.setdefault(pending_section, int(m.group(1), 16))
+            pending_section = None
+            continue
+
+        m = SECTION.match(line)
+        if m and m.group(1).startswith(".time_critical."):
+            section = m.group(1)[len(".time_critical."):]
+            if section in names:
+                if m.group(2):
+                    found.setdefault(section, int(m.group(2), 16))
+                else:
+                    pending_section = section
+            continue
+
+        m = SYMBOL.match(line)
+        if m:
+            address, text = int(m.group(1), 16), m.group(2).strip()
+            for name in names:
+                if name not in found and matches(name, text):
+                    found[name] = address
+
+failed = False
+for name in names:
+    address = found.get(name)
+    if address is None:
+        status = "MISSING"
+        failed = True
+    elif SRAM_START <= address < SRAM_END:
+        status = "SRAM"
+    else:
+        status = "FLASH"
+        failed = True
+    where = f"0x{address:08x}" if address is not None else "-"
+    print(f"{status:8} {where:12} {name}")
+
+sys.exit(1 if failed else 0)
@@ -0,0 +1,136 @@
+import argparse
+import random
+
+# Simulates the fixed FIFO debounce against PICADE_ADAPTIVE_DEBOUNCE (debounce.cpp)
+# on modelled switches, and reports how much release latency adapting saves and
+# what it costs in phantom presses while it learns.
+#
+# Both debouncers see the raw line once per report, every REPORT_US.
+
+REPORT_US = 1000
+STEP_US = 50
+
+FIXED_DEPTH = 5  # debounce_depth in picade.cpp
+
+# Mirrors debounce.hpp
+DEFAULT_WINDOW = 5
+MARGIN = 1
+SHRINK_AFTER = 32
+
+# Switch models: (longest release bounce us, longest press bounce us)
+SWITCHES = {
+    "face button": (300, 200),
+    "joystick": (2500, 500),
+    "worn joystick": (5000, 1000),
+}
+
+
+class Fixed:
+    def __init__(self, depth):
+        self.fifo = [False] * depth
+
+    def update(self, high):
+        self.fifo = self.fifo[1:] + [high]
+        return any(self.fifo)
+
+
+class Adaptive:
+    def __init__(self, window_min, window_max):
+        self.min = window_min
+        self.max = window_max
+        self.window = DEFAULT_WINDOW
+        self.low_for = 255
+        self.clean = 0
+
+    def clamp(self, window):
+        return max(self.min, min(self.max, window))
+
+    def update(self, high):
+        if high:
+            if 0 < self.low_for < self.max:
+                self.window = max(self.window, self.clamp(self.low_for + 1 + MARGIN))
+                self.clean = 0
+            self.low_for = 0
+        elif self.low_for < 255:
+            self.low_for += 1
+            if self.low_for == self.max:
+                self.clean += 1
+                if self.clean >= SHRINK_AFTER:
+                    self.clean = 0
+                    self.window = max(self.min, self.window - 1)
+        return self.low_for < self.window
+
+
+def bounce(rng, start_us, longest_us, settle_high):
+    # Contact chatter: alternating segments until the switch settles
+    edges = []
+    t = start_us
+    end = start_us + rng.uniform(0, longest_us)
+    state = not settle_high
+    while t < end:
+        edges.append((t, state))
+        t += rng.uniform(20, 300)
+        state = not state
+    edges.append((max(t, end), settle_high))
+    return edges
+
+
+def waveform(rng, presses, release_bounce_us, press_bounce_us):
+    # Returns (edges, release times), edges are (time us, high)
+    edges = [(0, False)]
+    releases = []
+    t = 50000
+    for _ in range(presses):
+        edges += bounce(rng, t, press_bounce_us, True)
+        t += rng.uniform(40000, 250000)
+        releases.append(t)
+        edges += bounce(rng, t, release_bounce_us, False)
+        t += rng.uniform(40000, 250000)
+    return edges, releases, t
+
+
+def run(debouncer, edges, releases, end_us, phase_us):
+    reported = False
+    presses = 0
+    latencies = []
+    next_release = 0
+    edge = 0
+    high = False
+    for t in range(phase_us, int(end_us), REPORT_US):
+        while edge < len(edges) and edges[edge][0] <= t:
+            high = edges[edge][1]
+            edge += 1
+        now = debouncer.update(high)
+        if now and not reported:
+            presses += 1
+        if reported and not now:
+            # Attribute the reported release to the most recent real release
+            while next_release + 1 < len(releases) and releases[next_release + 1] <= t:
+                next_release += 1
+            if next_release < len(releases) and releases[next_release] <= t:
+                latencies.append(t - releases[next_release])
+        reported = now
+    return presses, latencies
+
+
+parser = argparse.ArgumentParser(description="Fixed vs adaptive debounce simulation")
+parser.add_argument("--presses", type=int, default=2000)
+parser.add_argument("--min", type=int, default=1, help="PICADE_DEBOUNCE_MIN")
+parser.add_argument("--max", type=int, default=10, help="PICADE_DEBOUNCE_MAX")
+parser.add_argument("--seed", type=int, default=1)
+args = parser.parse_args()
+
+rng = random.Random(args.seed)
+
+print(f"{args.presses} presses per switch, {REPORT_US}us reports, fixed depth {FIXED_DEPTH}, adaptive {args.min}-{args.max}")
+print(f"{'switch':14} {'debounce':9} {'mean release':>13} {'p99 release':>12} {'phantoms':>9} {'window':>7}")
+for name, (release_bounce, press_bounce) in SWITCHES.items():
+    edges, releases, end_us = waveform(rng, args.presses, release_bounce, press_bounce)
+    phase = rng.randrange(REPORT_US)
+    for label, debouncer in (("fixed", Fixed(FIXED_DEPTH)), ("adaptive", Adaptive(args.min, args.max))):
+        presses, latencies = run(debouncer, edges, releases, end_us, phase)
+        latencies.sort()
+        mean = sum(latencies) / len(latencies) / 1000
+        p99 = latencies[int(len(latencies) * 0.99)] / 1000
+        window = getattr(debouncer, "window", FIXED_DEPTH)
+        print(f"{name:14} {label:9} {mean:11.2f}ms {p99:10.2f}ms {presses - args.presses:9d} {window:7d}")
@@ -0,0 +1,35 @@
+import struct
+import sys
+import serial
+from telemetry import find_port, read_reply
+
+# Shows the release windows learned by PICADE_ADAPTIVE_DEBOUNCE, one per input line,
+# laid out by mux row (scan byte) and line (bit) as in BUTTONS.md.
+#
+# Usage: debounce-windows.py [port] [--save]
+
+args = [a for a in sys.argv[1:] if not a.startswith("--")]
+port = find_port(args[0] if args else None)
+
+INFO = struct.Struct("<BBBB")
+DEBOUNCE_STATS = struct.Struct("<IIII")  # debounce_stats_t
+
+device = serial.Serial(port, timeout=2)
+device.write(b"multiverse:dbnc")
+reply = read_reply(device, "dbnc")
+
+window_min, window_max, lines, dirty = INFO.unpack_from(reply)
+bounces, escaped, grown, shrunk = DEBOUNCE_STATS.unpack_from(reply, INFO.size)
+windows = reply[INFO.size + DEBOUNCE_STATS.size:][:lines]
+
+print(f"Windows {window_min}-{window_max} reports{', unsaved' if dirty else ''}")
+print(f"Bounces: {bounces} escaped {escaped}, windows grown {grown} shrunk {shrunk}")
+print("byte  " + " ".join(f"bit{b}" for b in range(8)))
+for row in range(lines // 8):
+    print(f"{row:4}  " + " ".join(f"{w:4}" for w in windows[row * 8:row * 8 + 8]))
+
+if "--save" in sys.argv:
+    device.write(b"multiverse:dbsv")
+    print("Saved to flash" if read_reply(device, "dbsv")[0] else "Nothing to save")
+
+device.close()
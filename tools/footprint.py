@@ -0,0 +1,129 @@
+import re
+import sys
+
+# Reports RAM and flash use per module from a GNU ld map file, checked against a budget.
+# Modules are this firmware's own source files, with TinyUSB, the Pico SDK,
+# Pimoroni libraries and each toolchain library lumped together.
+#
+# Usage: footprint.py <firmware.elf.map> [<budget file>]
+#
+# The budget file has one "<module> <ram bytes> <flash bytes>" per line, "-" for no limit.
+# A "total" line limits the whole image.
+
+SRAM_START = 0x20000000
+SRAM_END = 0x20042000
+FLASH_START = 0x10000000
+FLASH_END = 0x11000000
+
+OUTPUT_SECTION = re.compile(r"^(\S+)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+load address 0x([0-9a-f]+))?)?\s*$")
+INPUT_SECTION = re.compile(r"^ (\S+)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*))?$")
+CONTINUATION = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+OUTPUT_CONTINUATION = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+load address 0x([0-9a-f]+))?\s*$")
+
+
+def in_ram(address):
+    return SRAM_START <= address < SRAM_END
+
+
+def in_flash(address):
+    return FLASH_START <= address < FLASH_END
+
+
+def module_of(path):
+    m = re.search(r"([^/\\]+)\.a\(", path)
+    if m:
+        return m.group(1)
+    for library in ("tinyusb", "pimoroni", "pico-sdk", "pico_sdk"):
+        if library in path:
+            return library.replace("_", "-")
+    name = re.split(r"[/\\]", path)[-1]
+    return name.split(".")[0] or "other"
+
+
+def parse(map_file):
+    usage = {}
+    in_map = False
+    loads_from_flash = False
+    pending = None  # A section name that wrapped onto the next line
+
+    def add(module, address, size):
+        totals = usage.setdefault(module, [0, 0])
+        if in_ram(address):
+            totals[0] += size
+            # Initialised data and RAM functions live in RAM but are copied there from flash
+            if loads_from_flash:
+                totals[1] += size
+        elif in_flash(address):
+            totals[1] += size
+
+    with open(map_file) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not in_map:
+                in_map = line.startswith("Linker script and memory map")
+                continue
+
+            if pending == "output":
+                m = OUTPUT_CONTINUATION.match(line)
+                if m:
+                    loads_from_flash = bool(m.group(3)) and in_flash(int(m.group(3), 16))
+                pending = None
+                continue
+            if pending == "input":
+                m = CONTINUATION.match(line)
+                if m:
+                    add(module_of(m.group(3)), int(m.group(1), 16), int(m.group(2), 16))
+                pending = None
+                continue
+
+            if line and not line[0].isspace():
+                m = OUTPUT_SECTION.match(line)
+                if m and m.group(1).startswith("."):
+                    if m.group(2):
+                        load = m.group(4)
+                        loads_from_flash = bool(load) and in_flash(int(load, 16))
+                    else:
+                        pending = "output"
+                continue
+
+            m = INPUT_SECTION.match(line)
+            if m and m.group(1) != "*fill*" and (m.group(1).startswith(".") or m.group(1) == "COMMON"):
+                if m.group(2):
+                    add(module_of(m.group(4)), int(m.group(2), 16), int(m.group(3), 16))
+                else:
+                    pending = "input"
+    return usage
+
+
+def load_budget(budget_file):
+    budget = {}
+    with open(budget_file) as f:
+        for line in f:
+            line = line.split("#")[0].split()
+            if len(line) == 3:
+                budget[line[0]] = [None if v == "-" else int(v) for v in line[1:]]
+    return budget
+
+
+if len(sys.argv) < 2:
+    print("Usage: footprint.py <map> [<budget>]")
+    sys.exit(2)
+
+usage = parse(sys.argv[1])
+budget = load_budget(sys.argv[2]) if len(sys.argv) > 2 else {}
+usage["total"] = [sum(u[0] for u in usage.values()), sum(u[1] for u in usage.values())]
+
+def limit(value):
+    return "-" if value is None else str(value)
+
+
+failed = False
+print(f"{'module':16} {'ram':>8} {'budget':>8} {'flash':>8} {'budget':>8}")
+for module in sorted(usage, key=lambda m: (m == "total", -usage[m][0])):
+    ram, flash = usage[module]
+    ram_limit, flash_limit = budget.get(module, [None, None])
+    over = (ram_limit is not None and ram > ram_limit) or (flash_limit is not None and flash > flash_limit)
+    failed |= over
+    print(f"{module:16} {ram:8} {limit(ram_limit):>8} {flash:8} {limit(flash_limit):>8}{'  OVER' if over else ''}")
+
+sys.exit(1 if failed else 0)
@@ -0,0 +1,32 @@
+import struct
+import sys
+import time
+import serial
+from telemetry import find_port, read_reply
+
+# Reads main loop timing from the Picade, for comparing builds such as
+# PICADE_HOT_PATHS_IN_RAM or PICADE_COPY_TO_RAM against a plain XIP build.
+# Run something busy on the LEDs (rainbow-leds.py) alongside for a worst case.
+#
+# Usage: loop-time.py [port] [seconds]
+
+port = find_port(sys.argv[1] if len(sys.argv) > 1 else None)
+SECONDS = float(sys.argv[2]) if len(sys.argv) > 2 else 10.0
+
+LOOP_STATS = struct.Struct("<III")  # loop_stats_t
+
+device = serial.Serial(port, timeout=2)
+
+# The first read clears out whatever was counted before we started
+device.write(b"multiverse:loop")
+read_reply(device, "loop")
+time.sleep(SECONDS)
+device.write(b"multiverse:loop")
+passes, total_us, max_us = LOOP_STATS.unpack(read_reply(device, "loop"))
+device.close()
+
+if not passes:
+    print("No loop passes counted")
+    sys.exit(1)
+
+print(f"Passes: {passes} mean {total_us / passes:.2f}us worst {max_us}us")
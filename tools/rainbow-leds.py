@@ -1,42 +1,86 @@
+import argparse
 import time
 import serial
+from telemetry import find_port, read_reply
+import struct
 from colorsys import hsv_to_rgb
 
-port = serial.Serial('/dev/ttyACM0', 115200)
+def frame_count(text):
+    # The device reads the batch size as a uint8
+    count = int(text)
+    if not 0 <= count <= 255:
+        raise argparse.ArgumentTypeError("must be 1-255, or 0 for multiverse:data")
+    return count
 
-NUM_LEDS = 16 * 4
 
-buf = bytearray(NUM_LEDS * 4)
-buf[::4] = [0b11100000 | 31] * NUM_LEDS
+parser = argparse.ArgumentParser(description="Rainbow LED demo and LED upload benchmark")
+parser.add_argument("port", nargs="?", default=None)
+parser.add_argument("--bulk", type=frame_count, default=0, help="send N (1-255) frames per multiverse:bulk batch (0 uses multiverse:data)")
+parser.add_argument("--seconds", type=float, default=0, help="stop after this long and print a summary")
+args = parser.parse_args()
 
-t_start = time.time()
-count = 0
+port = serial.Serial(find_port(args.port), 115200, timeout=2)
+
+# 32 buttons * 4 LEDs, each B G R brightness
+NUM_LEDS = 32 * 4
+FRAME_SIZE = NUM_LEDS * 4
+
+buf = bytearray(FRAME_SIZE)
+buf[3::4] = [31] * NUM_LEDS
 
 def set_pixel(x, r, g, b):
-    buf[x * 4 + 1] = b
-    buf[x * 4 + 2] = g
-    buf[x * 4 + 3] = r
+    buf[x * 4 + 0] = b
+    buf[x * 4 + 1] = g
+    buf[x * 4 + 2] = r
 
 
-while True:
+def render():
     h = (time.time() / 2.0) % 1.0
 
     for x in range(NUM_LEDS):
         o = float(x) / NUM_LEDS
         r, g, b = [int(c * 255) for c in hsv_to_rgb(h + o, 1.0, 1.0)]
         set_pixel(x, r, g, b)
-    #buf[5:8] = (r, g, b)
-    #buf[1::4] = [b] * NUM_LEDS
-    #buf[2::4] = [g] * NUM_LEDS
-    #buf[3::4] = [r] * NUM_LEDS
-
-    port.write(buf)
-    #port.flush()
-    count += 1
-    #time.sleep(1.0 / 60)
+    return bytes(buf)
+
+
+def send_data():
+    port.write(b"multiverse:data" + render())
+    return 1
+
+
+def send_bulk():
+    frames = b"".join(render() for _ in range(args.bulk))
+    port.write(b"multiverse:bulk" + bytes([args.bulk]) + frames)
+    # Wait for the device to account for the batch before sending another
+    return read_reply(port, "bulk")[0]
+
+
+send = send_bulk if args.bulk else send_data
+
+t_start = t_bench = time.time()
+count = total = 0
+
+while not args.seconds or time.time() - t_bench < args.seconds:
+    count += send()
+
     if time.time() - t_start >= 1.0:
-        print(f"FPS: {count} {len(buf)}")
+        elapsed = time.time() - t_start
+        print(f"FPS: {count / elapsed:.1f} {count * FRAME_SIZE / elapsed / 1e6:.3f} MB/s")
+        total += count
         count = 0
         t_start = time.time()
 
-port.close()
\ No newline at end of file
+total += count
+elapsed = time.time() - t_bench
+print(f"Total: {total} frames in {elapsed:.2f}s, {total / elapsed:.1f} frames/s, {total * FRAME_SIZE / elapsed / 1e6:.3f} MB/s")
+
+# uint32 now followed by plasma_stats_t
+port.reset_input_buffer()
+port.write(b"multiverse:stat")
+now_us, refreshes, presented, dropped, last_present_us, queued, irq_us = struct.unpack("<7I", read_reply(port, "stat"))
+print(f"Device: {refreshes} refreshes, {presented} presented, {dropped} dropped, "
+      f"last shown {(now_us - last_present_us) & 0xffffffff} us ago, "
+      f"{irq_us / max(refreshes, 1):.1f} us refresh IRQ time")
+
+port.close()
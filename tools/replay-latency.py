@@ -0,0 +1,135 @@
+import glob
+import select
+import struct
+import sys
+import threading
+import time
+import serial
+from telemetry import find_port, read_reply
+
+try:
+    import evdev
+except ImportError:
+    evdev = None
+
+# Uploads a timed script of raw input states, lets the Picade run them through
+# its normal debounce/mapping/HID path, then compares when each step was due with:
+#
+# - queued: when the device queued the report carrying it, read back with rlog
+# - host:   when the kernel delivered it as an input event (needs python-evdev and
+#           read access to the Picade's player 1 event device)
+#
+# Host times are measured from when the upload finished writing, which is when the
+# device starts the script give or take a USB frame, so treat them as +/- 1ms.
+#
+# Usage: replay-latency.py [port] [presses] [interval_ms]
+
+port = find_port(sys.argv[1] if len(sys.argv) > 1 else None)
+PRESSES = int(sys.argv[2]) if len(sys.argv) > 2 else 32
+INTERVAL_US = int(sys.argv[3]) * 1000 if len(sys.argv) > 3 else 20 * 1000
+
+MAX_STEPS = 128
+STEP = struct.Struct("<I8s")       # replay_step_t
+EVENT = struct.Struct("<IHHBBxx")  # replay_event_t
+
+# Player 1 "A" is byte 0, bit 1 of the raw scan (see BUTTONS.md), gamepad button 1
+RELEASED = bytes(8)
+PRESSED = bytes([0b00000010]) + bytes(7)
+P1_A = 1 << 0
+
+# Player 1 is the first interface, the only one without an -ifNN suffix
+GAMEPAD_GLOB = "/dev/input/by-id/usb-Pimoroni_Picade_Max_*-event-joystick"
+
+
+def find_gamepad():
+    if evdev is None:
+        print("python-evdev isn't installed, reporting device times only")
+        return None
+    paths = [p for p in sorted(glob.glob(GAMEPAD_GLOB)) if "-if" not in p]
+    if not paths:
+        print(f"No Picade Max gamepad at {GAMEPAD_GLOB}, reporting device times only")
+        return None
+    try:
+        return evdev.InputDevice(paths[0])
+    except PermissionError:
+        print(f"Can't open {paths[0]}, reporting device times only")
+        return None
+
+
+def capture(gamepad, stop, events):
+    # Button 1 presses and releases as (host time, value), until told to stop
+    while not stop.is_set():
+        ready, _, _ = select.select([gamepad.fd], [], [], 0.1)
+        if ready:
+            for event in gamepad.read():
+                if event.type == evdev.ecodes.EV_KEY and event.code == evdev.ecodes.BTN_SOUTH:
+                    events.append((event.timestamp(), event.value))
+
+
+def summary(name, latencies):
+    latencies = sorted(latencies)
+    print(f"{name} latency us: min {latencies[0]:.0f} median {latencies[len(latencies) // 2]:.0f} "
+          f"p99 {latencies[int(len(latencies) * 0.99)]:.0f} max {latencies[-1]:.0f}")
+
+
+steps = []
+for n in range(min(PRESSES * 2, MAX_STEPS)):
+    steps.append((n * INTERVAL_US, PRESSED if n % 2 == 0 else RELEASED))
+
+device = serial.Serial(port, timeout=2)
+gamepad = find_gamepad()
+
+host_events = []
+stop = threading.Event()
+if gamepad:
+    capturing = threading.Thread(target=capture, args=(gamepad, stop, host_events))
+    capturing.start()
+
+script = b"".join(STEP.pack(t, data) for t, data in steps)
+device.write(b"multiverse:rply" + struct.pack("<H", len(steps)) + script)
+device.flush()
+start = time.time()  # Same clock as evdev timestamps
+
+# Wait out the script plus the device's tail period
+time.sleep(steps[-1][0] / 1e6 + 0.2)
+
+if gamepad:
+    stop.set()
+    capturing.join()
+    gamepad.close()
+
+device.reset_input_buffer()
+device.write(b"multiverse:rlog")
+log = read_reply(device, "rlog")
+count, = struct.unpack_from("<H", log)
+events = [EVENT.unpack_from(log, 2 + n * EVENT.size) for n in range(count)]
+device.close()
+
+# Match each step to the first report reflecting it
+latencies = []
+for time_us, p1, p2, util, step in events:
+    pressed = bool(p1 & P1_A)
+    if pressed == (step % 2 == 0):
+        latencies.append(time_us - steps[step][0])
+
+if not latencies:
+    print("No matching reports")
+    sys.exit(1)
+
+span_us = events[-1][0] - events[0][0]
+print(f"Steps: {len(steps)} Reports: {count} Matched: {len(latencies)}")
+summary("Queued", latencies)
+if span_us:
+    print(f"Throughput: {(count - 1) * 1e6 / span_us:.1f} changes/s")
+
+if gamepad:
+    # Steps alternate press/release, so the nth press event belongs to the nth press step
+    host_latencies = []
+    for kind in (1, 0):
+        step_times = [t for n, (t, _) in enumerate(steps) if (n % 2 == 0) == bool(kind)]
+        event_times = [t for t, value in host_events if value == kind]
+        for step_us, event_time in zip(step_times, event_times):
+            host_latencies.append((event_time - start) * 1e6 - step_us)
+    print(f"Host events: {len(host_events)} of {len(steps)} steps")
+    if host_latencies:
+        summary("Host", host_latencies)
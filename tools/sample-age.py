@@ -0,0 +1,49 @@
+import struct
+import sys
+import time
+import serial
+from telemetry import find_port, read_reply
+
+# Reads the HID report sample-age histogram, the time from an input sample being
+# taken to its report being collected by the host.
+#
+# Usage: sample-age.py [port] [seconds]
+
+port = find_port(sys.argv[1] if len(sys.argv) > 1 else None)
+SECONDS = float(sys.argv[2]) if len(sys.argv) > 2 else 5.0
+
+BUCKET_US = 100
+BUCKETS = 32
+
+device = serial.Serial(port, timeout=2)
+
+# The first read clears out whatever was counted before we started
+device.write(b"multiverse:ages")
+read_reply(device, "ages")
+time.sleep(SECONDS)
+device.write(b"multiverse:ages")
+hist = struct.unpack(f"<{BUCKETS}I", read_reply(device, "ages"))
+device.close()
+
+total = sum(hist)
+if not total:
+    print("No reports collected")
+    sys.exit(1)
+
+
+def percentile(p):
+    target = total * p
+    seen = 0
+    for i, count in enumerate(hist):
+        seen += count
+        if seen >= target:
+            return (i + 1) * BUCKET_US
+    return BUCKETS * BUCKET_US
+
+
+print(f"Reports: {total}")
+print(f"Sample age <= p50 {percentile(0.5)}us p90 {percentile(0.9)}us p99 {percentile(0.99)}us")
+for i, count in enumerate(hist):
+    if count:
+        label = f">={i * BUCKET_US}" if i == BUCKETS - 1 else f"{i * BUCKET_US}-{(i + 1) * BUCKET_US}"
+        print(f"{label:>10}us {count:8d} {'#' * (count * 60 // max(hist))}")
@@ -0,0 +1,31 @@
+import struct
+import sys
+import time
+import serial
+from telemetry import find_port, read_reply
+
+# Reads input scan consistency counters: how many sweeps completed, and how often
+# picade_get_input() saw the same sweep twice, missed sweeps or had to retry a copy.
+#
+# Usage: scan-stats.py [port] [seconds]
+
+port = find_port(sys.argv[1] if len(sys.argv) > 1 else None)
+SECONDS = float(sys.argv[2]) if len(sys.argv) > 2 else 5.0
+
+SCAN_STATS = struct.Struct("<IIII")  # picade_scan_stats_t
+
+device = serial.Serial(port, timeout=2)
+
+# The counters run freely, so report the difference over the interval
+device.write(b"multiverse:scan")
+before = SCAN_STATS.unpack(read_reply(device, "scan"))
+time.sleep(SECONDS)
+device.write(b"multiverse:scan")
+after = SCAN_STATS.unpack(read_reply(device, "scan"))
+device.close()
+
+sweeps, repeated, skipped, retries = [(b - a) & 0xffffffff for a, b in zip(before, after)]
+reads = sweeps - skipped + repeated
+
+print(f"Sweeps: {sweeps} ({sweeps / SECONDS:.0f}/s)")
+print(f"Reads: ~{reads} repeated {repeated} skipped sweeps {skipped} torn copies retried {retries}")
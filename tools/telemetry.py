@@ -0,0 +1,38 @@
+import glob
+import struct
+
+# Reads framed replies from the Picade's telemetry channel (telemetry.hpp).
+# Each record is a 4 character tag, uint16 length and uint16 sequence, then the payload.
+
+HEADER = struct.Struct("<4sHH")  # telemetry_header_t
+
+PORT_GLOB = "/dev/serial/by-id/usb-Pimoroni_Picade_Max_*"
+
+
+def find_port(port=None):
+    # The port given on the command line, or the first Picade Max plugged in
+    if port:
+        return port
+    ports = sorted(glob.glob(PORT_GLOB))
+    if not ports:
+        raise SystemExit(f"No Picade Max found at {PORT_GLOB}, pass the port explicitly")
+    return ports[0]
+
+
+def read_record(port):
+    header = port.read(HEADER.size)
+    if len(header) < HEADER.size:
+        raise TimeoutError("No reply from Picade")
+    tag, length, sequence = HEADER.unpack(header)
+    payload = port.read(length)
+    if len(payload) < length:
+        raise TimeoutError("Short reply from Picade")
+    return tag.decode("ascii", "replace"), sequence, payload
+
+
+def read_reply(port, tag):
+    # Skip over anything else in flight, such as INPUT_DEBUG records
+    while True:
+        got, _, payload = read_record(port)
+        if got == tag:
+            return payload
@@ -0,0 +1,109 @@
+import argparse
+import struct
+import time
+from telemetry import find_port, read_reply
+
+# Streams LED frames to the vendor bulk interface (build with -DPICADE_VENDOR_LEDS=ON).
+# --loopback swaps the USB device for an in-process stand-in that parses frames
+# exactly like vendor_leds.cpp, for testing the host side without hardware.
+# Over USB the device's own counts are read back afterwards from the serial port.
+
+VID = 0x2e8a
+PID = 0x1098
+EP_OUT = 0x06
+
+MAGIC = 0x4d50
+HEADER = struct.Struct("<HHHH")  # vendor_leds_header_t
+STATS = struct.Struct("<IIIHxx")  # vendor_leds_stats_t
+
+NUM_LEDS = 32 * 4
+FRAME_SIZE = NUM_LEDS * 4
+
+
+class USBTransport:
+    def __init__(self):
+        import usb.core
+        import usb.util
+        self.device = usb.core.find(idVendor=VID, idProduct=PID)
+        if self.device is None:
+            raise RuntimeError("Picade Max not found")
+        config = self.device.get_active_configuration()
+        self.interface = usb.util.find_descriptor(config, bInterfaceClass=0xff)
+        if self.interface is None:
+            raise RuntimeError("Firmware has no vendor interface, build with PICADE_VENDOR_LEDS")
+        usb.util.claim_interface(self.device, self.interface)
+
+    def write(self, data):
+        self.device.write(EP_OUT, data)
+
+
+class LoopbackTransport:
+    def __init__(self):
+        self.pending = bytearray()
+        self.frames = 0
+        self.skipped = 0
+        self.last_sequence = None
+        self.front_buffer = bytearray(FRAME_SIZE)
+
+    def write(self, data):
+        self.pending += data
+        while len(self.pending) >= HEADER.size:
+            magic, sequence, length, _ = HEADER.unpack_from(self.pending)
+            if magic != MAGIC or length > FRAME_SIZE:
+                del self.pending[0]
+                continue
+            if len(self.pending) < HEADER.size + length:
+                break
+            self.front_buffer[:length] = self.pending[HEADER.size:HEADER.size + length]
+            del self.pending[:HEADER.size + length]
+            if self.last_sequence is not None:
+                self.skipped += (sequence - self.last_sequence - 1) & 0xffff
+            self.last_sequence = sequence
+            self.frames += 1
+
+
+parser = argparse.ArgumentParser(description="Vendor bulk LED streaming benchmark")
+parser.add_argument("--loopback", action="store_true", help="use the local stand-in instead of USB")
+parser.add_argument("--seconds", type=float, default=5.0)
+parser.add_argument("--port", default=None, help="serial port to read the device stats from")
+args = parser.parse_args()
+
+transport = LoopbackTransport() if args.loopback else USBTransport()
+
+frame = bytearray(FRAME_SIZE)
+packet = bytearray(HEADER.size + FRAME_SIZE)
+sequence = 0
+
+t_start = time.time()
+cpu_start = time.process_time()
+count = 0
+
+while time.time() - t_start < args.seconds:
+    # Simple chase, one lit LED per frame
+    frame[:] = bytes(FRAME_SIZE)
+    led = count % NUM_LEDS
+    frame[led * 4:led * 4 + 4] = bytes((255, 255, 255, 31))
+
+    HEADER.pack_into(packet, 0, MAGIC, sequence, FRAME_SIZE, 0)
+    packet[HEADER.size:] = frame
+    transport.write(packet)
+
+    sequence = (sequence + 1) & 0xffff
+    count += 1
+
+elapsed = time.time() - t_start
+cpu = time.process_time() - cpu_start
+print(f"Frames: {count} in {elapsed:.2f}s, {count / elapsed:.1f} frames/s, "
+      f"{count * len(packet) / elapsed / 1e6:.3f} MB/s, CPU {cpu / count * 1e6:.1f} us/frame")
+
+if args.loopback:
+    print(f"Loopback received {transport.frames} frames, {transport.skipped} skipped")
+else:
+    import serial
+    time.sleep(0.1)  # Let the last frames drain through vendor_leds_task()
+    port = serial.Serial(find_port(args.port), timeout=2)
+    port.write(b"multiverse:vndr")
+    frames, skipped, resyncs, last_sequence = STATS.unpack(read_reply(port, "vndr"))
+    port.close()
+    print(f"Device received {frames} frames, {skipped} skipped, {resyncs} bytes resynced, "
+          f"last sequence {last_sequence} (sent {(sequence - 1) & 0xffff})")
@@ -94,18 +94,32 @@
 #define CFG_TUD_CDC               1
 #define CFG_TUD_MSC               0
 #define CFG_TUD_MIDI              0
+#ifdef PICADE_VENDOR_LEDS
+#define CFG_TUD_VENDOR            1
+#else
 #define CFG_TUD_VENDOR            0
+#endif
 
 // HID buffer size Should be sufficient to hold ID (if any) + Data
 #define CFG_TUD_HID_EP_BUFSIZE    16
 
-// CDC FIFO size of TX and RX
+// CDC FIFO size of TX and RX. RX takes whole LED frames. Replies, even a full
+// rlog, queue in the telemetry ring instead, and telemetry_task() only moves a
+// 64 byte packet across once tud_cdc_write_available() has room for it, so
+// four packets is plenty.
 #define CFG_TUD_CDC_RX_BUFSIZE    512
-#define CFG_TUD_CDC_TX_BUFSIZE    512
+#define CFG_TUD_CDC_TX_BUFSIZE    256
 
 // CDC Endpoint transfer buffer size, more is faster
 #define CFG_TUD_CDC_EP_BUFSIZE    512
 
+// Vendor FIFO size of TX and RX, RX holds two LED frames plus headers
+#define CFG_TUD_VENDOR_RX_BUFSIZE 1024
+#define CFG_TUD_VENDOR_TX_BUFSIZE 64
+
+// Vendor bulk endpoint size, 64 is the maximum at full speed
+#define CFG_TUD_VENDOR_EPSIZE     64
+
 #ifdef __cplusplus
  }
 #endif
@@ -39,6 +39,9 @@ enum
   ITF_KEYBOARD,
   ITF_CDC_0,
   ITF_CDC_0_DATA,
+#if CFG_TUD_VENDOR
+  ITF_VENDOR,
+#endif
   ITF_NUM_TOTAL
 };
 
@@ -50,6 +53,9 @@ enum
 #define EPNUM_CDC_0_OUT     0x02
 #define EPNUM_CDC_0_IN      0x82
 
+#define EPNUM_VENDOR_OUT    0x06
+#define EPNUM_VENDOR_IN     0x86
+
 //--------------------------------------------------------------------+
 // Device Descriptors
 //--------------------------------------------------------------------+
@@ -133,7 +139,11 @@ uint8_t const * tud_hid_descriptor_report_cb(uint8_t itf)
 // Configuration Descriptor
 //--------------------------------------------------------------------+
 
+#if CFG_TUD_VENDOR
+#define  CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN + TUD_HID_DESC_LEN + TUD_HID_DESC_LEN + TUD_CDC_DESC_LEN + TUD_VENDOR_DESC_LEN)
+#else
 #define  CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN + TUD_HID_DESC_LEN + TUD_HID_DESC_LEN + TUD_CDC_DESC_LEN)
+#endif
 
 uint8_t const desc_configuration[] =
 {
@@ -145,6 +155,10 @@ uint8_t const desc_configuration[] =
   TUD_HID_DESCRIPTOR(ITF_GAMEPAD_2, 5, HID_ITF_PROTOCOL_NONE,     sizeof(desc_hid_report_gamepad2), EPNUM_HID2, CFG_TUD_HID_EP_BUFSIZE, 1),
   TUD_HID_DESCRIPTOR(ITF_KEYBOARD,  6, HID_ITF_PROTOCOL_KEYBOARD, sizeof(desc_hid_report_keyboard), EPNUM_HID3, CFG_TUD_HID_EP_BUFSIZE, 1),
   TUD_CDC_DESCRIPTOR(ITF_CDC_0,     7, EPNUM_CDC_0_NOTIF, 8, EPNUM_CDC_0_OUT, EPNUM_CDC_0_IN, 64),
+#if CFG_TUD_VENDOR
+  // Interface number, string index, EP Out & IN address, EP size
+  TUD_VENDOR_DESCRIPTOR(ITF_VENDOR, 8, EPNUM_VENDOR_OUT, EPNUM_VENDOR_IN, CFG_TUD_VENDOR_EPSIZE),
+#endif
 };
 
 // Invoked when received GET CONFIGURATION DESCRIPTOR
@@ -171,9 +185,12 @@ char const* string_desc_arr [] =
   "GamePad 2",
   "Keyboard",
   "Plasma",
+  "Plasma Bulk",
 };
 
-static uint16_t _desc_str[32];
+// Longest string is the 16 digit serial, plus one for the header
+#define DESC_STR_MAX_CHARS 16
+static uint16_t _desc_str[1 + DESC_STR_MAX_CHARS];
 
 // Invoked when received GET STRING DESCRIPTOR request
 // Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
@@ -198,7 +215,7 @@ uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
 
     // Cap at max char
     chr_count = (uint8_t) strlen(str);
-    if ( chr_count > 31 ) chr_count = 31;
+    if ( chr_count > DESC_STR_MAX_CHARS ) chr_count = DESC_STR_MAX_CHARS;
 
     // Convert ASCII string into UTF-16
     for(uint8_t i=0; i<chr_count; i++)
@@ -0,0 +1,51 @@
+#include "vendor_leds.hpp"
+#include "plasma.hpp"
+#include "tusb.h"
+
+#if CFG_TUD_VENDOR
+
+vendor_leds_stats_t vendor_leds_stats = {0, 0, 0, 0};
+
+vendor_leds_header_t vendor_leds_header;
+size_t header_bytes = 0;
+size_t payload_bytes = 0;
+bool have_sequence = false;
+
+void vendor_leds_task() {
+    if(!tud_vendor_mounted()) return;
+
+    while(tud_vendor_available()) {
+        // Accumulate a header, sliding forward a byte at a time until the magic lines up
+        if(header_bytes < sizeof(vendor_leds_header)) {
+            uint8_t *p = (uint8_t *)&vendor_leds_header;
+            header_bytes += tud_vendor_read(p + header_bytes, sizeof(vendor_leds_header) - header_bytes);
+            if(header_bytes < sizeof(vendor_leds_header)) return;
+
+            if(vendor_leds_header.magic != VENDOR_LEDS_MAGIC
+            || vendor_leds_header.length > sizeof(led_front_buffer)) {
+                memmove(p, p + 1, sizeof(vendor_leds_header) - 1);
+                header_bytes--;
+                vendor_leds_stats.resyncs++;
+                continue;
+            }
+            payload_bytes = 0;
+        }
+
+        // Read straight into the front buffer, as much as the FIFO holds
+        payload_bytes += tud_vendor_read(led_front_buffer + payload_bytes, vendor_leds_header.length - payload_bytes);
+        if(payload_bytes < vendor_leds_header.length) return;
+
+        plasma_flip();
+
+        uint16_t expected = vendor_leds_stats.last_sequence + 1;
+        if(have_sequence && vendor_leds_header.sequence != expected) {
+            vendor_leds_stats.skipped += (uint16_t)(vendor_leds_header.sequence - expected);
+        }
+        vendor_leds_stats.last_sequence = vendor_leds_header.sequence;
+        vendor_leds_stats.frames++;
+        have_sequence = true;
+        header_bytes = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// Binary LED frames over the vendor bulk OUT endpoint.
+// Each frame is an 8 byte little-endian header followed by `length` bytes of
+// LED data in the same B G R brightness layout as multiverse:data.
+struct vendor_leds_header_t {
+    uint16_t magic;     // VENDOR_LEDS_MAGIC
+    uint16_t sequence;  // Incremented by the host for every frame
+    uint16_t length;    // Payload bytes, at most sizeof(led_front_buffer)
+    uint16_t flags;     // Reserved, send 0
+};
+
+const uint16_t VENDOR_LEDS_MAGIC = 0x4d50; // "PM"
+
+struct vendor_leds_stats_t {
+    uint32_t frames;    // Frames received and shown
+    uint32_t skipped;   // Gaps in the sequence number
+    uint32_t resyncs;   // Bytes thrown away hunting for a header
+    uint16_t last_sequence;
+};
+
+extern vendor_leds_stats_t vendor_leds_stats;
+
+void vendor_leds_task();